@@ -0,0 +1,55 @@
+#include <cluster/distance.hpp>
+#include <cluster/pam.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+  if(argc != 4) {
+    std::cout << "Missing Arguments: please enter the number of objects, dimensions and clusters.\n";
+    return EXIT_SUCCESS;
+  }
+
+  auto const n = static_cast<int>(std::strtol(argv[1], nullptr, 10));
+  auto const d = static_cast<int>(std::strtol(argv[2], nullptr, 10));
+  auto const k = static_cast<int>(std::strtol(argv[3], nullptr, 10));
+
+  // build a random matrix of objects
+  std::srand(42);
+  Eigen::MatrixXd const data = Eigen::MatrixXd::Random(n, d);
+  auto const distances = cluster::calculate_condensed_distance_matrix(data);
+
+  std::cout << "initialization, final cost, initialization time (ms), iteration time (ms), initialization share, "
+               "iterations\n";
+
+  for(auto const &strategy : {std::make_pair("default", cluster::init_strategy::automatic),
+          std::make_pair("build", cluster::init_strategy::build),
+          std::make_pair("lab", cluster::init_strategy::lab),
+          std::make_pair("k-medoids++", cluster::init_strategy::k_medoids_plus_plus)}) {
+    cluster::pam_options options;
+    options.init = strategy.second;
+
+    auto const clustering = cluster::alternating_medoids(k, distances, options);
+
+    // the medoid of each cluster, to add up the distance of each object to its medoid
+    std::vector<int> medoids(k);
+    for(auto const &medoid : clustering.medoid_to_cluster) {
+      medoids[medoid.second] = medoid.first;
+    }
+
+    double cost = 0.0;
+    for(int i = 0; i < n; ++i) {
+      cost += distances(i, medoids[clustering.classification[i]]);
+    }
+
+    auto const initialization_time = 1000.0 * clustering.initialization_time;
+    auto const iteration_time = 1000.0 * clustering.swap_time;
+
+    std::cout << strategy.first << ", " << cost << ", " << initialization_time << ", " << iteration_time << ", "
+              << initialization_time / (initialization_time + iteration_time) << ", " << clustering.passes << "\n";
+  }
+
+  return EXIT_SUCCESS;
+}
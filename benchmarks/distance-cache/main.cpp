@@ -0,0 +1,63 @@
+#include <cluster/pam.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+  if(argc != 4) {
+    std::cout << "Missing Arguments: please enter the number of objects, dimensions and clusters.\n";
+    return EXIT_SUCCESS;
+  }
+
+  auto const n = static_cast<int>(std::strtol(argv[1], nullptr, 10));
+  auto const d = static_cast<int>(std::strtol(argv[2], nullptr, 10));
+  auto const k = static_cast<int>(std::strtol(argv[3], nullptr, 10));
+
+  // build a random matrix of objects
+  std::srand(42);
+  Eigen::MatrixXd const data = Eigen::MatrixXd::Random(n, d);
+
+  cluster::pam_options options;
+  options.swap = cluster::swap_strategy::eager;
+
+  auto const row_bytes = static_cast<std::size_t>(n) * sizeof(double);
+
+  std::cout << "cached rows, cache (MiB), time (ms), hits, misses, hit rate\n";
+
+  // grow the budget from the k rows of the medoids up to the whole matrix
+  for(auto rows = static_cast<std::size_t>(k);; rows *= 4) {
+    rows = std::min(rows, static_cast<std::size_t>(n));
+
+    auto const oracle = cluster::make_distance_oracle(data, rows * row_bytes);
+
+    auto const start = std::chrono::steady_clock::now();
+    cluster::partition_around_medoids(k, oracle, options);
+    auto const end = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double, std::milli> const time = end - start;
+
+    auto const &statistics = oracle.statistics();
+    auto const requests = static_cast<double>(statistics.hits + statistics.misses);
+
+    std::cout << statistics.capacity << ", " << statistics.capacity * row_bytes / (1024.0 * 1024.0) << ", "
+              << time.count() << ", " << statistics.hits << ", " << statistics.misses << ", "
+              << statistics.hits / requests << "\n";
+
+    if(rows == static_cast<std::size_t>(n)) {
+      break;
+    }
+  }
+
+  // compare against calculating and storing every distance up front
+  auto const start = std::chrono::steady_clock::now();
+  cluster::partition_around_medoids(k, data, options);
+  auto const end = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::milli> const time = end - start;
+  std::cout << "full condensed matrix: " << time.count() << " ms\n";
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#include <cluster/distance.hpp>
+#include <cluster/pam.hpp>
+
+#include "pam_data.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+  if(argc != 4) {
+    std::cout << "Missing Arguments: please enter the number of objects, dimensions and clusters.\n";
+    return EXIT_SUCCESS;
+  }
+
+  auto const n = static_cast<int>(std::strtol(argv[1], nullptr, 10));
+  auto const d = static_cast<int>(std::strtol(argv[2], nullptr, 10));
+  auto const k = static_cast<int>(std::strtol(argv[3], nullptr, 10));
+
+  // build a random matrix of objects
+  std::srand(42);
+  Eigen::MatrixXd const data = Eigen::MatrixXd::Random(n, d);
+  auto const distances = cluster::calculate_condensed_distance_matrix(data);
+
+  std::cout << "initialization, initial cost, final cost, initialization time (ms), swap time (ms), total time (ms), "
+               "passes, swaps\n";
+
+  for(auto const &strategy : {std::make_pair("build", cluster::init_strategy::build),
+          std::make_pair("lab", cluster::init_strategy::lab),
+          std::make_pair("k-medoids++", cluster::init_strategy::k_medoids_plus_plus)}) {
+    cluster::pam_options options;
+    options.init = strategy.second;
+
+    auto const start = std::chrono::steady_clock::now();
+    auto clustering = cluster::initialize(k, distances, options);
+    auto const initialized = std::chrono::steady_clock::now();
+
+    auto const initial_cost = clustering.total_dissimilarity;
+    auto const statistics = cluster::refine(distances, options, &clustering);
+    auto const end = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double, std::milli> const initialization_time = initialized - start;
+    std::chrono::duration<double, std::milli> const swap_time = end - initialized;
+    std::chrono::duration<double, std::milli> const total_time = end - start;
+
+    std::cout << strategy.first << ", " << initial_cost << ", " << clustering.total_dissimilarity << ", "
+              << initialization_time.count() << ", " << swap_time.count() << ", " << total_time.count() << ", "
+              << statistics.passes << ", " << statistics.swaps << "\n";
+  }
+
+  return EXIT_SUCCESS;
+}
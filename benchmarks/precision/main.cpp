@@ -0,0 +1,85 @@
+#include <cluster/pam.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+/**
+ * Calculate the sum of the distances between each object and its medoid in double precision.
+ */
+double total_dissimilarity(Eigen::MatrixXd const &data, cluster::pam_result const &result)
+{
+  std::vector<int> const medoids(result.medoids.begin(), result.medoids.end());
+
+  double total = 0.0;
+  for(int i = 0; i < data.rows(); ++i) {
+    total += cluster::euclidean_distance(data.row(i), data.row(medoids[result.classification[i]]));
+  }
+
+  return total;
+}
+
+/**
+ * Cluster the data and report the time taken, the cost of the clustering and the memory used by the distances.
+ */
+template<typename Derived>
+cluster::pam_result run(char const *precision,
+    int const k,
+    Eigen::MatrixBase<Derived> const &data,
+    Eigen::MatrixXd const &reference,
+    cluster::pam_options const &options)
+{
+  auto const start = std::chrono::steady_clock::now();
+  auto const distances = cluster::calculate_condensed_distance_matrix(data, options.distance);
+  auto const middle = std::chrono::steady_clock::now();
+  auto const result = cluster::partition_around_medoids(k, distances, options);
+  auto const end = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double, std::milli> const distance_time = middle - start;
+  std::chrono::duration<double, std::milli> const pam_time = end - middle;
+
+  auto const megabytes = distances.size() * sizeof(typename Derived::Scalar) / (1024.0 * 1024.0);
+
+  std::cout << precision << ", " << megabytes << ", " << distance_time.count() << ", " << pam_time.count() << ", "
+            << total_dissimilarity(reference, result) << "\n";
+
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  if(argc != 4) {
+    std::cout << "Missing Arguments: please enter the number of objects, dimensions and clusters.\n";
+    return EXIT_SUCCESS;
+  }
+
+  auto const n = static_cast<int>(std::strtol(argv[1], nullptr, 10));
+  auto const d = static_cast<int>(std::strtol(argv[2], nullptr, 10));
+  auto const k = static_cast<int>(std::strtol(argv[3], nullptr, 10));
+
+  // build a random matrix of objects and a single precision copy of it
+  std::srand(42);
+  Eigen::MatrixXd const data = Eigen::MatrixXd::Random(n, d);
+  Eigen::MatrixXf const data_float = data.cast<float>();
+
+  for(auto const method : {cluster::distance_method::direct, cluster::distance_method::matrix_product}) {
+    cluster::pam_options options;
+    options.distance.method = method;
+
+    std::cout << (method == cluster::distance_method::direct ? "direct" : "matrix product") << "\n";
+    std::cout << "precision, distances (MiB), distance time (ms), pam time (ms), total dissimilarity\n";
+
+    auto const double_result = run("double", k, data, data, options);
+    auto const float_result = run("float", k, data_float, data, options);
+
+    int agreements = 0;
+    for(int i = 0; i < n; ++i) {
+      agreements += double_result.classification[i] == float_result.classification[i];
+    }
+
+    std::cout << "objects classified identically: " << agreements << " of " << n << "\n\n";
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#include <cluster/distance.hpp>
+#include <cluster/pam.hpp>
+
+#include "pam_data.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+int main(int argc, char **argv)
+{
+  if(argc != 3) {
+    std::cout << "Missing Arguments: please enter the number of objects and the number of swaps.\n";
+    return EXIT_SUCCESS;
+  }
+
+  auto const n = static_cast<int>(std::strtol(argv[1], nullptr, 10));
+  auto const swaps = static_cast<int>(std::strtol(argv[2], nullptr, 10));
+
+  // build a random 2-dimensional matrix of objects
+  std::srand(42);
+  Eigen::MatrixXd const data = Eigen::MatrixXd::Random(n, 2);
+  auto const distances = cluster::calculate_condensed_distance_matrix(data);
+
+  std::cout << "k, full (ms), incremental (ms), speedup\n";
+
+  for(int k = 2; k <= n / 2 && k <= 256; k *= 2) {
+    auto full = cluster::build(k, distances);
+    auto incremental = full;
+
+    // perform the same random swaps on both clusterings
+    std::mt19937 generator(k);
+    std::uniform_int_distribution<int> random_position(0, k - 1);
+    std::uniform_int_distribution<int> random_object(0, n - 1);
+
+    std::chrono::duration<double, std::milli> full_time(0);
+    std::chrono::duration<double, std::milli> incremental_time(0);
+
+    for(int swap = 0; swap < swaps; ++swap) {
+      auto const old_medoid = full.medoids[random_position(generator)];
+
+      int new_medoid = random_object(generator);
+      while(full.is_medoid(new_medoid)) {
+        new_medoid = random_object(generator);
+      }
+
+      auto const start = std::chrono::steady_clock::now();
+      full.swap_medoid(old_medoid, new_medoid);
+      cluster::reclassify_objects(distances, &full);
+      auto const middle = std::chrono::steady_clock::now();
+      cluster::swap_medoid(distances, old_medoid, new_medoid, &incremental);
+      auto const end = std::chrono::steady_clock::now();
+
+      full_time += middle - start;
+      incremental_time += end - middle;
+    }
+
+    if(full.nearest != incremental.nearest || full.second != incremental.second) {
+      std::cout << "Error: the incremental assignment differs from the full assignment.\n";
+      return EXIT_FAILURE;
+    }
+
+    std::cout << k << ", " << full_time.count() << ", " << incremental_time.count() << ", "
+              << full_time.count() / incremental_time.count() << "\n";
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+#include <cluster/distance.hpp>
+#include <cluster/pam.hpp>
+
+#include "pam_data.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+// count every allocation made through the global operator new
+static std::atomic<long> allocations(0);
+
+void *operator new(std::size_t size)
+{
+  ++allocations;
+
+  if(void *pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+int main(int argc, char **argv)
+{
+  if(argc != 3) {
+    std::cout << "Missing Arguments: please enter the number of objects and the number of clusters.\n";
+    return EXIT_SUCCESS;
+  }
+
+  auto const n = static_cast<int>(std::strtol(argv[1], nullptr, 10));
+  auto const k = static_cast<int>(std::strtol(argv[2], nullptr, 10));
+
+  // build a random 2-dimensional matrix of objects
+  std::srand(42);
+  Eigen::MatrixXd const data = Eigen::MatrixXd::Random(n, 2);
+  auto const distances = cluster::calculate_condensed_distance_matrix(data);
+
+  cluster::pam_options best;
+
+  cluster::pam_options multiple;
+  multiple.swaps_per_pass = k;
+
+  cluster::pam_options eager;
+  eager.swap = cluster::swap_strategy::eager;
+
+  std::cout << "strategy, passes, swaps, allocations\n";
+
+  for(auto const &strategy : {std::make_pair("best", best),
+          std::make_pair("best (multiple)", multiple),
+          std::make_pair("eager", eager)}) {
+    auto clustering = cluster::build(k, distances);
+
+    auto const before = allocations.load();
+    auto const statistics = cluster::refine(distances, strategy.second, &clustering);
+    auto const after = allocations.load();
+
+    std::cout << strategy.first << ", " << statistics.passes << ", " << statistics.swaps << ", "
+              << after - before << "\n";
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#include <cluster/distance.hpp>
+#include <cluster/pam.hpp>
+
+#include "pam_data.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+/**
+ * Calculate the effect of swapping the medoid i with the object h one pair at a time, as the classic SWAP does
+ * (Kaufman and Rousseeuw, 1990).
+ */
+double classic_swap_cost(cluster::condensed_matrix const &distances,
+    int const i,
+    int const h,
+    cluster::pam_data<double> const &clustering)
+{
+  double total_contribution = 0.0;
+
+  for(int j = 0; j < distances.rows(); ++j) {
+    auto const D_j = clustering.nearest_distance[j];
+    auto const d_j_i = distances(j, i);
+    auto const d_j_h = distances(j, h);
+
+    double contribution = 0.0;
+    if(D_j >= d_j_i) {
+      auto const E_j = clustering.second_distance[j];
+      contribution = d_j_h < E_j ? d_j_h - d_j_i : E_j - D_j;
+    } else if(D_j > d_j_h) {
+      contribution = d_j_h - D_j;
+    }
+
+    total_contribution += contribution;
+  }
+
+  return total_contribution;
+}
+
+/**
+ * Perform the most favourable swap of all pairs until no swap improves the clustering, examining the medoids in
+ * increasing order and then the objects in increasing order, so the first of equally favourable swaps is performed.
+ */
+void classic_swap(cluster::condensed_matrix const &distances, cluster::pam_data<double> *clustering)
+{
+  while(true) {
+    auto medoids = clustering->medoids;
+    std::sort(medoids.begin(), medoids.end());
+
+    double minimum_contribution = std::numeric_limits<double>::max();
+    int old_medoid = -1;
+    int new_medoid = -1;
+
+    for(auto const i : medoids) {
+      for(int h = 0; h < distances.rows(); ++h) {
+        if(clustering->is_medoid(h)) {
+          continue;
+        }
+
+        auto const contribution = classic_swap_cost(distances, i, h, *clustering);
+        if(contribution < minimum_contribution) {
+          minimum_contribution = contribution;
+          old_medoid = i;
+          new_medoid = h;
+        }
+      }
+    }
+
+    // the same tolerance as the library, so that swaps between equally good medoids end
+    if(!(minimum_contribution < -16 * std::numeric_limits<double>::epsilon() * clustering->total_dissimilarity)) {
+      return;
+    }
+
+    clustering->swap_medoid(old_medoid, new_medoid);
+    cluster::reclassify_objects(distances, clustering);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if(argc != 2) {
+    std::cout << "Missing Arguments: please enter the number of random problems.\n";
+    return EXIT_SUCCESS;
+  }
+
+  auto const problems = static_cast<int>(std::strtol(argv[1], nullptr, 10));
+
+  std::cout << "threads, problems, identical\n";
+
+  for(int threads : {1, 4}) {
+    int identical = 0;
+
+    for(int problem = 0; problem < problems; ++problem) {
+      // small problems with few dimensions have many nearly equal swaps, which expose any change in rounding
+      std::srand(problem);
+      auto const n = 20 + problem % 181;
+      auto const d = 1 + problem % 3;
+      auto const k = 2 + problem % 7;
+
+      Eigen::MatrixXd const data = Eigen::MatrixXd::Random(n, d);
+      auto const distances = cluster::calculate_condensed_distance_matrix(data);
+
+      auto reference = cluster::build(k, distances);
+      auto clustering = reference;
+
+      classic_swap(distances, &reference);
+
+      cluster::pam_options options;
+      options.threads = threads;
+      cluster::refine(distances, options, &clustering);
+
+      auto reference_medoids = reference.medoids;
+      auto medoids = clustering.medoids;
+      std::sort(reference_medoids.begin(), reference_medoids.end());
+      std::sort(medoids.begin(), medoids.end());
+
+      if(medoids != reference_medoids) {
+        std::cout << "Error: the medoids of problem " << problem << " (" << n << " objects, " << d << " dimensions, k = "
+                  << k << ") differ from the classic SWAP.\n";
+        return EXIT_FAILURE;
+      }
+
+      ++identical;
+    }
+
+    std::cout << threads << ", " << problems << ", " << identical << "\n";
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include <cluster/distance.hpp>
+#include <cluster/pam.hpp>
+
+#include "pam_data.hpp"
+
+#include <cstdlib>
+#include <iostream>
+
+int main(int argc, char **argv)
+{
+  if(argc != 3) {
+    std::cout << "Missing Arguments: please enter the number of objects and the number of clusters.\n";
+    return EXIT_SUCCESS;
+  }
+
+  auto const n = static_cast<int>(std::strtol(argv[1], nullptr, 10));
+  auto const k = static_cast<int>(std::strtol(argv[2], nullptr, 10));
+
+#ifndef CLUSTER_ENABLE_THREADS
+  std::cout << "Warning: the library is built without CLUSTER_ENABLE_THREADS, so every thread count uses one thread.\n";
+#endif
+
+  // build a random 2-dimensional matrix of objects
+  std::srand(42);
+  Eigen::MatrixXd const data = Eigen::MatrixXd::Random(n, 2);
+  auto const distances = cluster::calculate_condensed_distance_matrix(data);
+
+  // the medoids and labels found with one thread are the reference for every other number of threads
+  auto const serial_build = cluster::build(k, distances);
+
+  cluster::pam_options serial_options;
+  auto const serial_best = cluster::partition_around_medoids(k, distances, serial_options);
+
+  serial_options.swaps_per_pass = k;
+  auto const serial_multiple = cluster::partition_around_medoids(k, distances, serial_options);
+
+  std::cout << "threads, build, best, best (multiple)\n";
+
+  bool identical = true;
+
+  for(int threads : {2, 3, 4, 8}) {
+    auto const build = cluster::build(k, distances, threads);
+    auto const same_build = build.medoids == serial_build.medoids && build.nearest == serial_build.nearest;
+
+    cluster::pam_options options;
+    options.threads = threads;
+    auto const best = cluster::partition_around_medoids(k, distances, options);
+    auto const same_best =
+        best.medoids == serial_best.medoids && best.classification == serial_best.classification;
+
+    options.swaps_per_pass = k;
+    auto const multiple = cluster::partition_around_medoids(k, distances, options);
+    auto const same_multiple =
+        multiple.medoids == serial_multiple.medoids && multiple.classification == serial_multiple.classification;
+
+    std::cout << threads << ", " << (same_build ? "same" : "different") << ", " << (same_best ? "same" : "different")
+              << ", " << (same_multiple ? "same" : "different") << "\n";
+
+    identical = identical && same_build && same_best && same_multiple;
+  }
+
+  if(!identical) {
+    std::cout << "Error: the clustering depends on the number of threads.\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+#ifndef CAPPA_CLUSTER_BATCH_HPP
+#define CAPPA_CLUSTER_BATCH_HPP
+
+#include "cluster/detail/parallel.hpp"
+#include "cluster/metric.hpp"
+#include "cluster/pam.hpp"
+#include "cluster/pam_workspace.hpp"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+namespace cluster {
+
+/**
+ * The clusterings of a batch of independent problems, packed one problem after another into flat arrays.
+ */
+struct pam_batch_result {
+  /**
+   * The objects of problem p are found from object_offsets[p] up to object_offsets[p + 1], in the same order as the
+   * objects given to the batch.
+   */
+  std::vector<int> object_offsets;
+
+  /**
+   * The medoids of problem p are found from medoid_offsets[p] up to medoid_offsets[p + 1].
+   */
+  std::vector<int> medoid_offsets;
+
+  /**
+   * The medoids of each problem in increasing order, as indices of objects within the problem, so that the medoid of
+   * cluster c of problem p is medoids[medoid_offsets[p] + c].
+   */
+  std::vector<int> medoids;
+
+  /**
+   * The cluster ID each object was assigned to within its problem.
+   */
+  std::vector<std::int32_t> labels;
+
+  /**
+   * The distance from each object to the medoid of its cluster.
+   */
+  std::vector<double> distances;
+
+  /**
+   * The sum of the distances from each object to the medoid of its cluster, for each problem.
+   */
+  std::vector<double> total_dissimilarities;
+
+  /**
+   * The number of passes and swaps performed by the swap phase for each problem.
+   */
+  std::vector<int> passes;
+  std::vector<int> swaps;
+};
+
+/**
+ * Minimize the sum of dissimilarities to a set of medoids for each of many small, independent problems.
+ *
+ * The objects of every problem are stacked into one matrix, and each problem is clustered with its own k. The problems
+ * are distributed over options.threads threads: each thread takes the next problem that has not been started when it
+ * finishes a problem, so threads that are given small problems take more of them. Each thread clusters its problems
+ * with one thread and its own workspace, so the buffers of a thread are reused from one problem to the next.
+ *
+ * @param objects The objects observed, one per row, where the objects of each problem are contiguous.
+ * @param offsets The first object of each problem, followed by the number of objects.
+ * @param k The number of clusters of each problem.
+ * @param options Options that control how medoids are found, which are the same for every problem.
+ * @param metric The metric used to calculate the distances between observations.
+ *
+ * @return The clustering of every problem, which does not depend on the number of threads.
+ */
+template<typename Metric = euclidean, typename Derived>
+pam_batch_result partition_around_medoids_batch(Eigen::MatrixBase<Derived> const &objects,
+    std::vector<int> const &offsets,
+    std::vector<int> const &k,
+    pam_options const &options = pam_options(),
+    Metric const &metric = Metric())
+{
+  auto const problems = static_cast<int>(k.size());
+
+  if(offsets.size() != k.size() + 1) {
+    throw std::runtime_error("Error: the batch must have one offset per problem, followed by the number of objects.");
+  } else if(offsets.front() != 0 || offsets.back() != objects.rows()) {
+    throw std::runtime_error("Error: the offsets of the batch must start at zero and end at the number of objects.");
+  } else if(options.precomputed) {
+    throw std::runtime_error("Error: a batch must contain observations rather than dissimilarities.");
+  } else if(!options.initial_medoids.empty()) {
+    throw std::runtime_error("Error: the problems of a batch cannot share initial medoids.");
+  }
+
+  pam_batch_result result;
+  result.object_offsets = offsets;
+  result.medoid_offsets.resize(problems + 1, 0);
+
+  for(int p = 0; p < problems; ++p) {
+    if(offsets[p + 1] < offsets[p]) {
+      throw std::runtime_error("Error: the offsets of the batch must not decrease.");
+    }
+
+    detail::validate(k[p], offsets[p + 1] - offsets[p], options);
+    result.medoid_offsets[p + 1] = result.medoid_offsets[p] + k[p];
+  }
+
+  result.medoids.resize(result.medoid_offsets.back());
+  result.labels.resize(objects.rows());
+  result.distances.resize(objects.rows());
+  result.total_dissimilarities.resize(problems);
+  result.passes.resize(problems);
+  result.swaps.resize(problems);
+
+  // the problems are already spread over the threads, so each problem is clustered by one thread
+  auto problem_options = options;
+  problem_options.threads = 1;
+  problem_options.distance.threads = 1;
+
+  auto const workers = std::min(detail::thread_count(options.threads), std::max(problems, 1));
+
+  std::vector<basic_pam_workspace<typename Derived::Scalar>> workspaces(workers);
+  std::vector<std::exception_ptr> errors(workers);
+  std::atomic<int> next_problem(0);
+
+  detail::parallel_for(workers, workers, [&](int worker) {
+    auto &workspace = workspaces[worker];
+
+    try {
+      for(int p = next_problem++; p < problems; p = next_problem++) {
+        auto const first = offsets[p];
+        auto const &clustering = workspace.partition_around_medoids(k[p],
+            objects.middleRows(first, offsets[p + 1] - first),
+            problem_options,
+            metric);
+
+        // every problem has its own region of the result, so no two threads write to the same element
+        std::copy(clustering.medoids.begin(), clustering.medoids.end(), result.medoids.begin() + result.medoid_offsets[p]);
+        std::copy(clustering.labels.begin(), clustering.labels.end(), result.labels.begin() + first);
+        std::copy(clustering.distances.begin(), clustering.distances.end(), result.distances.begin() + first);
+
+        result.total_dissimilarities[p] = clustering.total_dissimilarity;
+        result.passes[p] = clustering.passes;
+        result.swaps[p] = clustering.swaps;
+      }
+    } catch(...) {
+      errors[worker] = std::current_exception();
+    }
+  });
+
+  for(auto const &error : errors) {
+    if(error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  return result;
+}
+}
+
+#endif //CAPPA_CLUSTER_BATCH_HPP
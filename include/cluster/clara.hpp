@@ -0,0 +1,232 @@
+#ifndef CAPPA_CLUSTER_CLARA_HPP
+#define CAPPA_CLUSTER_CLARA_HPP
+
+#include "cluster/detail/parallel.hpp"
+#include "cluster/metric.hpp"
+#include "cluster/pam.hpp"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace cluster {
+
+/**
+ * Options that control how CLARA samples the objects.
+ */
+struct clara_options {
+  /**
+   * The number of samples to cluster.
+   */
+  int samples = 5;
+
+  /**
+   * The number of objects in each sample, where zero uses 40 + 2k objects as suggested by Kaufman and Rousseeuw.
+   */
+  int sample_size = 0;
+
+  /**
+   * The seed of the random number generator. The same seed always draws the same samples.
+   */
+  unsigned seed = 0;
+
+  /**
+   * The number of samples to cluster at the same time, where zero uses one thread per hardware thread.
+   */
+  int threads = 1;
+
+  /**
+   * Options that control how the medoids of each sample are found.
+   */
+  pam_options pam;
+};
+
+namespace detail {
+
+/**
+ * Draw a sample of objects without replacement, in increasing order.
+ */
+inline std::vector<int> draw_sample(int number_of_objects, int sample_size, unsigned seed, int sample)
+{
+  // each sample has its own generator so that the samples do not depend on the order they are drawn in
+  std::seed_seq sequence{seed, static_cast<unsigned>(sample)};
+  std::mt19937 generator(sequence);
+
+  std::vector<int> objects(number_of_objects);
+  std::iota(objects.begin(), objects.end(), 0);
+
+  // a partial Fisher-Yates shuffle moves a uniform sample to the front
+  for(int i = 0; i < sample_size; ++i) {
+    std::uniform_int_distribution<int> distribution(i, number_of_objects - 1);
+    std::swap(objects[i], objects[distribution(generator)]);
+  }
+
+  objects.resize(sample_size);
+  std::sort(objects.begin(), objects.end());
+
+  return objects;
+}
+
+/**
+ * Find the nearest of a sorted set of medoids to an object, preferring the lowest medoid when they are equally distant.
+ *
+ * @return The position of the nearest medoid, and its distance through the distance argument.
+ */
+template<typename Observations, typename Metric>
+int nearest_medoid(Observations const &matrix,
+    std::vector<int> const &medoids,
+    int object,
+    Metric const &metric,
+    double *distance)
+{
+  auto nearest = 0;
+  auto nearest_distance = std::numeric_limits<double>::max();
+
+  for(std::size_t m = 0; m < medoids.size(); ++m) {
+    // a medoid is always the nearest medoid to itself
+    if(medoids[m] == object) {
+      *distance = 0.0;
+      return static_cast<int>(m);
+    }
+
+    double const d = metric(matrix.row(object), matrix.row(medoids[m]));
+
+    if(d < nearest_distance) {
+      nearest_distance = d;
+      nearest = static_cast<int>(m);
+    }
+  }
+
+  *distance = nearest_distance;
+  return nearest;
+}
+
+/**
+ * The medoids found by clustering one sample and the cost of assigning every object to them.
+ */
+struct clara_sample {
+  std::vector<int> medoids;
+  double total_dissimilarity = std::numeric_limits<double>::max();
+  int passes = 0;
+  int swaps = 0;
+};
+}
+
+/**
+ * Minimize the sum of dissimilarities to a set of k medoids for large sets of objects, using CLARA (Kaufman and
+ * Rousseeuw, 1990).
+ *
+ * Each sample of objects is clustered with partition_around_medoids, so only the distances within a sample are
+ * stored. The medoids of each sample are scored by the total distance of every object to its nearest medoid, and every
+ * object is assigned to the best set of medoids in a final pass. Unlike the original algorithm, the samples are drawn
+ * independently of each other so that they can be clustered in parallel; the result only depends on the seed.
+ *
+ * @param k The number of clusters.
+ * @param matrix The objects observed, one per row, with float or double elements.
+ * @param options Options that control how the objects are sampled and clustered.
+ * @param metric The metric used to calculate the distances between objects.
+ *
+ * @return The clustering found, where passes and swaps describe the sample that was chosen.
+ */
+template<typename Metric = euclidean, typename Derived>
+pam_result clara(int k,
+    Eigen::MatrixBase<Derived> const &matrix,
+    clara_options const &options = clara_options(),
+    Metric const &metric = Metric())
+{
+  auto const number_of_objects = static_cast<int>(matrix.rows());
+  detail::validate(k, number_of_objects, options.pam);
+
+  auto const sample_size = std::min(options.sample_size > 0 ? options.sample_size : 40 + 2 * k, number_of_objects);
+
+  if(options.samples < 1) {
+    throw std::runtime_error("Error: at least one sample must be clustered.");
+  } else if(!options.pam.initial_medoids.empty()) {
+    throw std::runtime_error("Error: CLARA cannot start from initial medoids, since each sample has different objects.");
+  } else if(options.pam.precomputed) {
+    throw std::runtime_error("Error: CLARA samples observations rather than dissimilarities.");
+  } else if(options.pam.distance.method == distance_method::matrix_product
+      && !detail::is_euclidean<Metric>::value) {
+    throw std::runtime_error("Error: the matrix product method requires a Euclidean metric.");
+  } else if(sample_size < k) {
+    throw std::runtime_error("Error: a sample must contain at least k objects.");
+  }
+
+  using Scalar = typename Derived::Scalar;
+
+  detail::observations<Derived> const objects(matrix);
+  std::vector<detail::clara_sample> samples(options.samples);
+  std::vector<std::exception_ptr> errors(options.samples);
+
+  // parallel_for must not throw, so an error in any sample is passed back to the calling thread
+  detail::parallel_for(options.samples, options.threads, [&](int s) {
+    try {
+      auto const sample = detail::draw_sample(number_of_objects, sample_size, options.seed, s);
+
+      Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> sampled_objects(sample_size, objects.cols());
+      for(int i = 0; i < sample_size; ++i) {
+        sampled_objects.row(i) = objects.row(sample[i]);
+      }
+
+      auto const result = partition_around_medoids(k, sampled_objects, options.pam, metric);
+
+      auto &clustering = samples[s];
+      clustering.passes = result.passes;
+      clustering.swaps = result.swaps;
+
+      // the medoids are sorted because the sample is sorted
+      for(auto const medoid : result.medoids) {
+        clustering.medoids.push_back(sample[medoid]);
+      }
+
+      clustering.total_dissimilarity = 0.0;
+      for(int i = 0; i < number_of_objects; ++i) {
+        double distance;
+        detail::nearest_medoid(objects, clustering.medoids, i, metric, &distance);
+        clustering.total_dissimilarity += distance;
+      }
+    } catch(...) {
+      errors[s] = std::current_exception();
+    }
+  });
+
+  for(auto const &error : errors) {
+    if(error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // choose the first of the samples with the lowest cost, regardless of the order they finished in
+  auto const best = std::min_element(samples.begin(),
+      samples.end(),
+      [](detail::clara_sample const &a, detail::clara_sample const &b) {
+        return a.total_dissimilarity < b.total_dissimilarity;
+      });
+
+  pam_result final_clustering;
+  final_clustering.passes = best->passes;
+  final_clustering.swaps = best->swaps;
+  final_clustering.medoids.insert(best->medoids.begin(), best->medoids.end());
+
+  for(std::size_t m = 0; m < best->medoids.size(); ++m) {
+    final_clustering.medoid_to_cluster[best->medoids[m]] = static_cast<int>(m);
+  }
+
+  // assign every object to the best medoids in a single pass
+  final_clustering.classification.resize(number_of_objects);
+  for(int i = 0; i < number_of_objects; ++i) {
+    double distance;
+    final_clustering.classification[i] = detail::nearest_medoid(objects, best->medoids, i, metric, &distance);
+  }
+
+  return final_clustering;
+}
+}
+
+#endif //CAPPA_CLUSTER_CLARA_HPP
@@ -0,0 +1,152 @@
+#ifndef CAPPA_CLUSTER_CONDENSED_MATRIX_HPP
+#define CAPPA_CLUSTER_CONDENSED_MATRIX_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace cluster {
+namespace detail {
+
+/**
+ * @return The position of the entry (i, j), for i != j, in the condensed storage of a matrix with size rows.
+ */
+inline std::size_t condensed_index(std::size_t size, int i, int j)
+{
+  if(i > j) {
+    std::swap(i, j);
+  }
+
+  auto const row = static_cast<std::size_t>(i);
+  return row * (2 * size - row - 1) / 2 + static_cast<std::size_t>(j - i - 1);
+}
+
+/**
+ * Call a function with j and the entry (j, h) of a condensed matrix for every j in increasing order, without computing
+ * the position of each entry. The entries (j, h) for j < h are found by stepping from one row to the next, and the
+ * entries for j > h are contiguous.
+ *
+ * @param data The entries stored above the diagonal.
+ * @param size The number of rows of the matrix.
+ * @param h The column to read.
+ * @param function A function that receives j and the entry (j, h).
+ */
+template<typename Scalar, typename Function>
+void for_each_condensed_entry(Scalar const *data, int const size, int const h, Function &&function)
+{
+  // the position after (j, h), which starts at h since (0, h) is at h - 1; the rows shrink by one entry each, so
+  // (j + 1, h) is found size - j - 2 entries after (j, h)
+  auto after = static_cast<std::size_t>(h);
+  for(int j = 0; j < h; ++j) {
+    function(j, data[after - 1]);
+    after += static_cast<std::size_t>(size - j - 2);
+  }
+
+  function(h, Scalar(0));
+
+  auto const *row = data + condensed_index(static_cast<std::size_t>(size), h, h + 1);
+  for(int j = h + 1; j < size; ++j) {
+    function(j, row[j - h - 1]);
+  }
+}
+}
+
+/**
+ * A symmetric matrix with a zero diagonal, such as a distance matrix, that only stores the entries above the diagonal.
+ *
+ * The entries are stored row by row, so entry (i, j) with i < j is found at i * (2n - i - 1) / 2 + (j - i - 1).
+ *
+ * @tparam T The type of the entries, such as float or double.
+ */
+template<typename T>
+class basic_condensed_matrix {
+public:
+  using Scalar = T;
+
+  /**
+   * Create a matrix of zeros.
+   *
+   * @param size The number of rows (and columns) of the matrix.
+   */
+  explicit basic_condensed_matrix(int size = 0)
+      : m_size(size)
+      , m_data(size > 1 ? static_cast<std::size_t>(size) * (size - 1) / 2 : 0, Scalar(0))
+  {
+  }
+
+  /**
+   * Change the number of rows without setting the entries, which keep their previous values and must all be set
+   * before the matrix is read, as when calculating a distance matrix into it. The storage is reused when the matrix
+   * does not grow.
+   */
+  void resize(int size)
+  {
+    m_size = size;
+    m_data.resize(size > 1 ? static_cast<std::size_t>(size) * (size - 1) / 2 : 0);
+  }
+
+  int rows() const
+  {
+    return m_size;
+  }
+
+  int cols() const
+  {
+    return m_size;
+  }
+
+  /**
+   * @return The number of entries stored above the diagonal.
+   */
+  std::size_t size() const
+  {
+    return m_data.size();
+  }
+
+  Scalar operator()(int i, int j) const
+  {
+    if(i == j) {
+      return Scalar(0);
+    }
+
+    return m_data[index(i, j)];
+  }
+
+  /**
+   * Set the entries (i, j) and (j, i), which must not lie on the diagonal.
+   */
+  void set(int i, int j, Scalar value)
+  {
+    m_data[index(i, j)] = value;
+  }
+
+  Scalar *data()
+  {
+    return m_data.data();
+  }
+
+  Scalar const *data() const
+  {
+    return m_data.data();
+  }
+
+  /**
+   * @return The position of the entry (i, j) in the condensed storage, for i != j.
+   */
+  std::size_t index(int i, int j) const
+  {
+    return detail::condensed_index(static_cast<std::size_t>(m_size), i, j);
+  }
+
+private:
+  int m_size;
+  std::vector<Scalar> m_data;
+};
+
+/**
+ * A condensed matrix of double precision entries.
+ */
+using condensed_matrix = basic_condensed_matrix<double>;
+}
+
+#endif //CAPPA_CLUSTER_CONDENSED_MATRIX_HPP
@@ -0,0 +1,118 @@
+#ifndef CAPPA_CLUSTER_DETAIL_MAPPED_FILE_HPP
+#define CAPPA_CLUSTER_DETAIL_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cluster {
+
+/**
+ * Hints given to the operating system about how a memory-mapped file will be read.
+ */
+enum class access_pattern {
+  /**
+   * No particular pattern, which uses the default read-ahead.
+   */
+  normal,
+
+  /**
+   * Pages are read in increasing order, so aggressive read-ahead is useful and pages can be freed soon after use.
+   */
+  sequential,
+
+  /**
+   * Pages are read in no particular order, so read-ahead is wasted.
+   */
+  random,
+
+  /**
+   * The whole file will be needed soon, so it should be read in the background.
+   */
+  will_need
+};
+
+namespace detail {
+
+/**
+ * A file that is mapped into memory. The mapping is removed and the file closed when the object is destroyed.
+ */
+class mapped_file {
+public:
+  /**
+   * Create (or replace) a file of a given size and map it for reading and writing.
+   */
+  mapped_file(std::string const &path, std::size_t size);
+
+  /**
+   * Map an existing file for reading only.
+   */
+  explicit mapped_file(std::string const &path);
+
+  ~mapped_file();
+
+  mapped_file(mapped_file const &) = delete;
+  mapped_file &operator=(mapped_file const &) = delete;
+
+  mapped_file(mapped_file &&other) noexcept;
+  mapped_file &operator=(mapped_file &&other) noexcept;
+
+  char *data() const
+  {
+    return m_data;
+  }
+
+  std::size_t size() const
+  {
+    return m_size;
+  }
+
+  /**
+   * Advise the operating system how the mapping will be read.
+   */
+  void advise(access_pattern pattern) const;
+
+  /**
+   * Write any modified pages back to the file.
+   */
+  void sync() const;
+
+private:
+  void close();
+
+  int m_descriptor;
+  char *m_data;
+  std::size_t m_size;
+};
+
+/**
+ * The header at the start of a file of condensed distances.
+ */
+struct mapped_header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t scalar_size;
+  std::uint64_t rows;
+};
+
+/**
+ * The distances start at this offset so that they are aligned for any scalar type.
+ */
+constexpr std::size_t mapped_data_offset = 64;
+
+/**
+ * Write the header of a file of condensed distances.
+ */
+void write_mapped_header(mapped_file const &file, std::size_t scalar_size, std::size_t rows);
+
+/**
+ * Read and validate the header of a file of condensed distances, throwing a std::runtime_error if the file was not
+ * written with the same scalar type or is truncated.
+ *
+ * @return The number of rows of the distance matrix.
+ */
+int read_mapped_header(mapped_file const &file, std::size_t scalar_size);
+}
+}
+
+#endif //CAPPA_CLUSTER_DETAIL_MAPPED_FILE_HPP
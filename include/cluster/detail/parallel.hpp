@@ -0,0 +1,85 @@
+#ifndef CAPPA_CLUSTER_DETAIL_PARALLEL_HPP
+#define CAPPA_CLUSTER_DETAIL_PARALLEL_HPP
+
+#include <algorithm>
+
+#ifdef CLUSTER_ENABLE_THREADS
+#include <atomic>
+#include <thread>
+#include <vector>
+#endif
+
+namespace cluster {
+namespace detail {
+
+/**
+ * Determine how many threads to use for a number of requested threads.
+ *
+ * @param requested The number of threads requested, where zero requests one thread per hardware thread.
+ *
+ * @return The number of threads to use, which is always one if threads are disabled.
+ */
+inline int thread_count(int requested)
+{
+#ifdef CLUSTER_ENABLE_THREADS
+  if(requested <= 0) {
+    requested = static_cast<int>(std::thread::hardware_concurrency());
+  }
+
+  return std::max(requested, 1);
+#else
+  (void)requested;
+  return 1;
+#endif
+}
+
+/**
+ * Call a function once for each task, distributing the tasks dynamically over a number of threads. The calling thread
+ * also performs tasks, and every task has been performed when the call returns.
+ *
+ * @param tasks The number of tasks, which are identified by 0 to tasks - 1.
+ * @param threads The number of threads requested, where zero requests one thread per hardware thread.
+ * @param function The function to call with the ID of each task. It must not throw.
+ */
+template<typename Function>
+void parallel_for(int const tasks, int const threads, Function function)
+{
+#ifdef CLUSTER_ENABLE_THREADS
+  auto const workers = std::min(thread_count(threads), tasks);
+
+  if(workers > 1) {
+    std::atomic<int> next_task(0);
+
+    auto const work = [&]() {
+      for(int task = next_task++; task < tasks; task = next_task++) {
+        function(task);
+      }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+
+    for(int worker = 1; worker < workers; ++worker) {
+      pool.emplace_back(work);
+    }
+
+    work();
+
+    for(auto &thread : pool) {
+      thread.join();
+    }
+
+    return;
+  }
+#else
+  (void)threads;
+#endif
+
+  for(int task = 0; task < tasks; ++task) {
+    function(task);
+  }
+}
+}
+}
+
+#endif //CAPPA_CLUSTER_DETAIL_PARALLEL_HPP
@@ -1,13 +1,445 @@
 #ifndef CAPPA_CLUSTER_DISTANCE_HPP
 #define CAPPA_CLUSTER_DISTANCE_HPP
 
+#include "cluster/condensed_matrix.hpp"
+#include "cluster/detail/parallel.hpp"
+#include "cluster/metric.hpp"
+
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
 namespace cluster {
 
-double euclidean_distance(Eigen::VectorXd const &vector1, Eigen::VectorXd const &vector2);
+/**
+ * The methods available for calculating a matrix of distances.
+ */
+enum class distance_method {
+  /**
+   * Calculate the norm of the difference between each pair of objects.
+   */
+  direct,
+
+  /**
+   * Expand ||x - y||^2 into ||x||^2 + ||y||^2 - 2 x.y and calculate the dot products of all pairs with a blocked
+   * matrix product. This is faster for high-dimensional objects, about 1.5 times for 2000 objects with 256 dimensions
+   * and 3.5 times with 1024 dimensions, but is subject to rounding errors for objects that are close together. It is
+   * only available for the euclidean and squared_euclidean metrics.
+   */
+  matrix_product
+};
+
+/**
+ * Options that control how distance matrices are calculated.
+ */
+struct distance_options {
+  /**
+   * The method used for calculating distances.
+   */
+  distance_method method = distance_method::direct;
+
+  /**
+   * When using matrix products, a squared distance that is smaller than this fraction of ||x||^2 + ||y||^2 is
+   * recalculated directly, because cancellation makes the expansion inaccurate for nearby objects. The relative error
+   * of the other squared distances is then about epsilon / threshold, for the machine epsilon of the scalar type. A
+   * negative value, the default, uses 64 sqrt(epsilon), which is about 1e-6 for double and 2e-2 for float, and a value
+   * of zero disables the recalculation.
+   */
+  double recalculation_threshold = -1.0;
+
+  /**
+   * The number of threads used for calculating distances, where zero uses one thread per hardware thread. Threads are
+   * only used when the library is built with CLUSTER_ENABLE_THREADS.
+   */
+  int threads = 1;
+};
+
+/**
+ * Calculate the Euclidean distance between two vectors without evaluating them into temporaries.
+ *
+ * @param vector1 The first vector, such as a row or column of a matrix.
+ * @param vector2 The second vector.
+ *
+ * @return The distance between the vectors.
+ */
+template<typename Derived1, typename Derived2>
+typename Derived1::Scalar euclidean_distance(Eigen::MatrixBase<Derived1> const &vector1,
+    Eigen::MatrixBase<Derived2> const &vector2)
+{
+  return euclidean()(vector1, vector2);
+}
+
+namespace detail {
+
+/**
+ * References to matrices of objects in each storage order, which bind to plain matrices, maps and blocks of them
+ * without copying.
+ */
+template<typename Scalar>
+using column_major_observations =
+    Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> const, 0, Eigen::OuterStride<>>;
+template<typename Scalar>
+using row_major_observations =
+    Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> const, 0, Eigen::OuterStride<>>;
+
+/**
+ * The reference to use for a matrix, which has the same scalar type and storage order as the matrix.
+ */
+template<typename Derived>
+using observations = typename std::conditional<Derived::IsRowMajor,
+    row_major_observations<typename Derived::Scalar>,
+    column_major_observations<typename Derived::Scalar>>::type;
+
+/**
+ * The number of rows in each block of the distance matrix, which is the unit of work given to a thread.
+ */
+constexpr int block_rows = 64;
+
+/**
+ * The number of columns in each tile of a block, chosen so that the objects of a tile stay in the cache.
+ */
+constexpr int tile_columns = 256;
+
+/**
+ * The number of rows in each panel of the distance matrix calculated with matrix products, which is the unit of work
+ * given to a thread. Each tile of a panel is one matrix product, so panels are much taller than the blocks of the
+ * direct method: with 64 rows Eigen spends most of its time packing the operands of many small products.
+ */
+constexpr int product_panel_rows = 512;
+
+/**
+ * The number of columns in each tile of a panel calculated with matrix products.
+ */
+constexpr int product_tile_columns = 512;
+
+/**
+ * Copy a range of objects into the first columns of a buffer, so that each object is contiguous in memory regardless
+ * of how the objects are stored. Only the objects of a block or tile are copied at a time. The buffer only grows, so a
+ * buffer that is kept between blocks is not reallocated for a smaller block.
+ *
+ * @param matrix The objects observed, one per row.
+ * @param first The first object to copy.
+ * @param count The number of objects to copy.
+ * @param buffer The buffer to copy the objects into.
+ */
+template<typename Observations, typename Buffer>
+void pack(Observations const &matrix, int const first, int const count, Buffer *buffer)
+{
+  if(buffer->rows() != matrix.cols() || buffer->cols() < count) {
+    buffer->resize(matrix.cols(), count);
+  }
+
+  buffer->leftCols(count) = matrix.middleRows(first, count).transpose();
+}
+
+/**
+ * Copy a range of objects into the first columns of a buffer after centering them on the mean of all objects, and
+ * their squared norms into the first entries of another. Both buffers only grow, as with pack.
+ */
+template<typename Observations, typename Mean, typename Buffer, typename Norms>
+void pack_centered(Observations const &matrix,
+    Mean const &mean,
+    int const first,
+    int const count,
+    Buffer *buffer,
+    Norms *norms)
+{
+  if(buffer->rows() != matrix.cols() || buffer->cols() < count) {
+    buffer->resize(matrix.cols(), count);
+  }
+
+  if(norms->size() < count) {
+    norms->resize(count);
+  }
+
+  buffer->leftCols(count) = (matrix.middleRows(first, count).rowwise() - mean).transpose();
+  norms->head(count) = buffer->leftCols(count).colwise().squaredNorm().transpose();
+}
+
+/**
+ * Calculate the distances between a block of objects and every later object by calling the metric for each pair, one
+ * tile of objects at a time.
+ *
+ * @param matrix The objects observed, one per row.
+ * @param first The first object of the block.
+ * @param metric The metric to calculate.
+ * @param store A function that receives i, j and the distance between them, for i < j.
+ */
+template<typename Observations, typename Metric, typename Function>
+void calculate_direct_block(Observations const &matrix, int const first, Metric const &metric, Function &store)
+{
+  using Scalar = typename Observations::Scalar;
+
+  auto const count = static_cast<int>(matrix.rows());
+  auto const last = std::min(first + block_rows, count);
+
+  // each thread keeps its buffers, so repeatedly calculating distances between a similar number of objects does not
+  // allocate memory
+  thread_local Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> block;
+  thread_local Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> tile;
+
+  pack(matrix, first, last - first, &block);
+
+  for(int tile_start = first; tile_start < count; tile_start += tile_columns) {
+    auto const tile_end = std::min(tile_start + tile_columns, count);
+
+    pack(matrix, tile_start, tile_end - tile_start, &tile);
+
+    for(int i = first; i < last; ++i) {
+      for(int j = std::max(i + 1, tile_start); j < tile_end; ++j) {
+        store(i, j, static_cast<Scalar>(metric(block.col(i - first), tile.col(j - tile_start))));
+      }
+    }
+  }
+}
+
+/**
+ * Calculate the Euclidean distances between a panel of objects and every later object using matrix products, one tile
+ * of objects at a time.
+ *
+ * @param matrix The objects observed, one per row.
+ * @param mean The mean of the objects.
+ * @param first The first object of the panel.
+ * @param threshold The fraction of the squared norms below which a distance is recalculated directly.
+ * @param metric The metric to calculate, which must be derived from the squared Euclidean distance.
+ * @param store A function that receives i, j and the distance between them, for i < j.
+ */
+template<typename Observations, typename Mean, typename Metric, typename Function>
+void calculate_expanded_block(Observations const &matrix,
+    Mean const &mean,
+    int const first,
+    double const threshold,
+    Metric const &metric,
+    Function &store)
+{
+  using Scalar = typename Observations::Scalar;
+
+  auto const count = static_cast<int>(matrix.rows());
+  auto const last = std::min(first + product_panel_rows, count);
+
+  // each thread keeps its buffers, as for the direct method
+  thread_local Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> block;
+  thread_local Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> tile;
+  thread_local Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> dot_products;
+  thread_local Eigen::Matrix<Scalar, Eigen::Dynamic, 1> block_norms;
+  thread_local Eigen::Matrix<Scalar, Eigen::Dynamic, 1> tile_norms;
+
+  if(dot_products.rows() < product_panel_rows || dot_products.cols() < product_tile_columns) {
+    dot_products.resize(product_panel_rows, product_tile_columns);
+  }
+
+  // centering the objects does not change their distances, but reduces the cancellation in the expansion
+  pack_centered(matrix, mean, first, last - first, &block, &block_norms);
+
+  for(int tile_start = first; tile_start < count; tile_start += product_tile_columns) {
+    auto const tile_end = std::min(tile_start + product_tile_columns, count);
+
+    pack_centered(matrix, mean, tile_start, tile_end - tile_start, &tile, &tile_norms);
+
+    dot_products.topLeftCorner(last - first, tile_end - tile_start).noalias() =
+        block.leftCols(last - first).transpose() * tile.leftCols(tile_end - tile_start);
 
-Eigen::MatrixXd calculate_distance_matrix(Eigen::MatrixXd const &matrix);
+    for(int i = first; i < last; ++i) {
+      for(int j = std::max(i + 1, tile_start); j < tile_end; ++j) {
+        auto const sum_of_norms = block_norms(i - first) + tile_norms(j - tile_start);
+
+        // rounding can make the squared distance of nearby objects negative
+        auto const squared_distance =
+            std::max(sum_of_norms - Scalar(2) * dot_products(i - first, j - tile_start), Scalar(0));
+
+        if(squared_distance < threshold * sum_of_norms) {
+          store(i, j, static_cast<Scalar>(metric(block.col(i - first), tile.col(j - tile_start))));
+        } else {
+          store(i, j, Metric::from_squared_euclidean(squared_distance));
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @return The fraction of the squared norms below which the matrix product method recalculates a distance, which by
+ * default scales with the precision of the scalar type so that float distances are recalculated as often as needed.
+ */
+template<typename Scalar>
+double recalculation_threshold(distance_options const &options)
+{
+  if(options.recalculation_threshold >= 0.0) {
+    return options.recalculation_threshold;
+  }
+
+  return 64.0 * std::sqrt(static_cast<double>(std::numeric_limits<Scalar>::epsilon()));
+}
+
+/**
+ * Distribute blocks of rows over threads, calculating the distances of each block directly or, for the matrix product
+ * method, panels of rows with matrix products.
+ */
+template<typename Observations, typename Metric, typename Function>
+void calculate_blocks(Observations const &matrix,
+    distance_options const &options,
+    Metric const &metric,
+    Function &store,
+    std::true_type)
+{
+  auto const blocks = static_cast<int>((matrix.rows() + block_rows - 1) / block_rows);
+
+  if(options.method != distance_method::matrix_product) {
+    parallel_for(blocks, options.threads, [&](int block) {
+      calculate_direct_block(matrix, block * block_rows, metric, store);
+    });
+
+    return;
+  }
+
+  using Scalar = typename Observations::Scalar;
+
+  // the threads read the mean through a reference, since a lambda does not capture a thread_local variable and each
+  // thread would otherwise see its own
+  thread_local Eigen::Matrix<Scalar, 1, Eigen::Dynamic> mean_buffer;
+  mean_buffer = matrix.colwise().mean();
+  auto const &mean = mean_buffer;
+  auto const panels = static_cast<int>((matrix.rows() + product_panel_rows - 1) / product_panel_rows);
+  auto const threshold = recalculation_threshold<Scalar>(options);
+
+  parallel_for(panels, options.threads, [&](int panel) {
+    calculate_expanded_block(matrix, mean, panel * product_panel_rows, threshold, metric, store);
+  });
+}
+
+/**
+ * Distribute blocks of rows over threads, calculating the distances of each block directly.
+ */
+template<typename Observations, typename Metric, typename Function>
+void calculate_blocks(Observations const &matrix,
+    distance_options const &options,
+    Metric const &metric,
+    Function &store,
+    std::false_type)
+{
+  if(options.method == distance_method::matrix_product) {
+    throw std::runtime_error("Error: the matrix product method requires a Euclidean metric.");
+  }
+
+  auto const blocks = static_cast<int>((matrix.rows() + block_rows - 1) / block_rows);
+
+  parallel_for(blocks, options.threads, [&](int block) {
+    calculate_direct_block(matrix, block * block_rows, metric, store);
+  });
+}
+
+/**
+ * Calculate the distances above the diagonal of the distance matrix, distributing blocks of rows over threads. The
+ * blocks below the diagonal are never calculated.
+ *
+ * @param matrix The objects observed, one per row.
+ * @param options Options that control how distances are calculated.
+ * @param metric The metric to calculate.
+ * @param store A function that receives i, j and the distance between them, for i < j. It is called concurrently,
+ * but never twice for the same pair.
+ */
+template<typename Observations, typename Metric, typename Function>
+void calculate_distances(Observations const &matrix, distance_options const &options, Metric const &metric, Function store)
+{
+  calculate_blocks(matrix, options, metric, store, is_euclidean<Metric>());
+}
+
+template<typename Observations, typename Metric>
+Eigen::Matrix<typename Observations::Scalar, Eigen::Dynamic, Eigen::Dynamic> calculate_distance_matrix(
+    Observations const &matrix,
+    distance_options const &options,
+    Metric const &metric)
+{
+  using Scalar = typename Observations::Scalar;
+
+  Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> distance_matrix =
+      Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>::Zero(matrix.rows(), matrix.rows());
+
+  // the matrix is symmetric with a zero diagonal, so each distance only needs to be calculated once
+  calculate_distances(matrix, options, metric, [&](int i, int j, Scalar distance) {
+    distance_matrix(i, j) = distance;
+    distance_matrix(j, i) = distance;
+  });
+
+  return distance_matrix;
+}
+
+template<typename Observations, typename Metric>
+basic_condensed_matrix<typename Observations::Scalar> calculate_condensed_distance_matrix(Observations const &matrix,
+    distance_options const &options,
+    Metric const &metric)
+{
+  using Scalar = typename Observations::Scalar;
+
+  basic_condensed_matrix<Scalar> distance_matrix(static_cast<int>(matrix.rows()));
+
+  calculate_distances(matrix, options, metric, [&](int i, int j, Scalar distance) {
+    distance_matrix.set(i, j, distance);
+  });
+
+  return distance_matrix;
+}
+
+/**
+ * The Euclidean distance matrices are compiled into the library for float and double observations in either storage
+ * order.
+ */
+#define CLUSTER_DECLARE_DISTANCE_MATRICES(Scalar, Observations)                                     \
+  extern template Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> calculate_distance_matrix( \
+      Observations<Scalar> const &, distance_options const &, euclidean const &);                   \
+  extern template basic_condensed_matrix<Scalar> calculate_condensed_distance_matrix(               \
+      Observations<Scalar> const &, distance_options const &, euclidean const &);
+
+CLUSTER_DECLARE_DISTANCE_MATRICES(float, column_major_observations)
+CLUSTER_DECLARE_DISTANCE_MATRICES(float, row_major_observations)
+CLUSTER_DECLARE_DISTANCE_MATRICES(double, column_major_observations)
+CLUSTER_DECLARE_DISTANCE_MATRICES(double, row_major_observations)
+
+#undef CLUSTER_DECLARE_DISTANCE_MATRICES
+}
+
+/**
+ * Calculate the distance between every pair of rows.
+ *
+ * @param matrix The objects observed, one per row, with float or double elements. Matrices in either storage order,
+ * maps over external buffers and blocks of them are read in place.
+ * @param options Options that control how distances are calculated.
+ * @param metric The metric to calculate, which is inlined into the calculation of each distance.
+ *
+ * @return The distance matrix, with the same scalar type as the objects.
+ */
+template<typename Metric = euclidean, typename Derived>
+Eigen::Matrix<typename Derived::Scalar, Eigen::Dynamic, Eigen::Dynamic> calculate_distance_matrix(
+    Eigen::MatrixBase<Derived> const &matrix,
+    distance_options const &options = distance_options(),
+    Metric const &metric = Metric())
+{
+  return detail::calculate_distance_matrix(detail::observations<Derived>(matrix), options, metric);
+}
+
+/**
+ * Calculate the distance between every pair of rows, computing each distance once and storing only the entries above
+ * the diagonal.
+ *
+ * @param matrix The objects observed, one per row, with float or double elements. Matrices in either storage order,
+ * maps over external buffers and blocks of them are read in place.
+ * @param options Options that control how distances are calculated.
+ * @param metric The metric to calculate, which is inlined into the calculation of each distance.
+ *
+ * @return The condensed distance matrix, with the same scalar type as the objects.
+ */
+template<typename Metric = euclidean, typename Derived>
+basic_condensed_matrix<typename Derived::Scalar> calculate_condensed_distance_matrix(
+    Eigen::MatrixBase<Derived> const &matrix,
+    distance_options const &options = distance_options(),
+    Metric const &metric = Metric())
+{
+  return detail::calculate_condensed_distance_matrix(detail::observations<Derived>(matrix), options, metric);
+}
 }
 
 #endif //CAPPA_CLUSTER_DISTANCE_HPP
@@ -0,0 +1,342 @@
+#ifndef CAPPA_CLUSTER_DISTANCE_ORACLE_HPP
+#define CAPPA_CLUSTER_DISTANCE_ORACLE_HPP
+
+#include "cluster/distance.hpp"
+#include "cluster/metric.hpp"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace cluster {
+
+/**
+ * Counters that describe how well the rows cached by a distance oracle were reused.
+ */
+struct distance_cache_statistics {
+  /**
+   * The number of times a row was requested and found in the cache. Consecutive requests for the same row are counted
+   * once.
+   */
+  std::size_t hits = 0;
+
+  /**
+   * The number of times a row was requested and had to be calculated.
+   */
+  std::size_t misses = 0;
+
+  /**
+   * The number of rows that fit in the cache.
+   */
+  int capacity = 0;
+};
+
+namespace detail {
+
+/**
+ * Calculate the distances between an object and every object, for objects stored one per row. Each object is
+ * contiguous, so the objects are read in place.
+ *
+ * @param objects The objects observed, one per row.
+ * @param row The object whose distances are calculated.
+ * @param metric The metric to calculate.
+ * @param distances Storage for the distance to each object.
+ */
+template<typename Scalar, typename Metric, typename Buffer>
+void calculate_oracle_row(row_major_observations<Scalar> const &objects,
+    int const row,
+    Metric const &metric,
+    Buffer *,
+    Buffer *,
+    Scalar *distances)
+{
+  auto const object = objects.row(row).transpose();
+
+  for(int i = 0; i < objects.rows(); ++i) {
+    // calculate each distance with the lower index first, as a full distance matrix would
+    distances[i] = i < row ? static_cast<Scalar>(metric(objects.row(i).transpose(), object))
+                           : static_cast<Scalar>(metric(object, objects.row(i).transpose()));
+  }
+
+  distances[row] = Scalar(0);
+}
+
+/**
+ * Calculate the distances between an object and every object, for objects stored one per column. The elements of an
+ * object are strided, so the object and one tile of objects at a time are packed into buffers first, as when
+ * calculating a distance matrix directly.
+ */
+template<typename Scalar, typename Metric, typename Buffer>
+void calculate_oracle_row(column_major_observations<Scalar> const &objects,
+    int const row,
+    Metric const &metric,
+    Buffer *object,
+    Buffer *tile,
+    Scalar *distances)
+{
+  auto const count = static_cast<int>(objects.rows());
+
+  pack(objects, row, 1, object);
+
+  for(int tile_start = 0; tile_start < count; tile_start += tile_columns) {
+    auto const tile_end = std::min(tile_start + tile_columns, count);
+
+    pack(objects, tile_start, tile_end - tile_start, tile);
+
+    for(int i = tile_start; i < tile_end; ++i) {
+      distances[i] = i < row ? static_cast<Scalar>(metric(tile->col(i - tile_start), object->col(0)))
+                             : static_cast<Scalar>(metric(object->col(0), tile->col(i - tile_start)));
+    }
+  }
+
+  distances[row] = Scalar(0);
+}
+}
+
+/**
+ * A distance matrix that calculates its rows on demand instead of storing every distance.
+ *
+ * Rows are calculated in full when they are first requested and kept in a cache of least recently used rows, whose
+ * size is bounded by a memory budget. This allows objects to be clustered when the distance matrix does not fit in
+ * memory, at the cost of recalculating rows that were evicted. The entry (i, j) is read from row j, so loops that fix
+ * j and vary i only need one row at a time.
+ *
+ * The objects are read in place rather than copied, so they must outlive the oracle. Objects stored one per column
+ * are packed into buffers owned by the oracle, one tile at a time, when a row is calculated. The cache is modified by
+ * const member functions, so an oracle must not be shared between threads.
+ *
+ * @tparam T The type of the distances, such as float or double.
+ */
+template<typename T>
+class basic_distance_oracle {
+public:
+  using Scalar = T;
+
+  /**
+   * Create an oracle over a set of objects.
+   *
+   * @param matrix The objects observed, one per row, which must be stored in memory with contiguous elements in each
+   * row or column, such as a matrix in either storage order, a map over an external buffer or a block of them.
+   * @param memory_budget The maximum number of bytes used to cache rows. At least one row is always cached.
+   * @param metric The metric used to calculate the distance between two objects.
+   */
+  template<typename Derived, typename Metric = euclidean>
+  basic_distance_oracle(Eigen::MatrixBase<Derived> const &matrix, std::size_t memory_budget, Metric metric = Metric())
+      : m_size(static_cast<int>(matrix.rows()))
+      , m_calculate_row(row_calculator(matrix, metric))
+      , m_last_row(-1)
+      , m_last_distances(nullptr)
+      , m_filled(0)
+      , m_head(-1)
+      , m_tail(-1)
+  {
+    auto const size = static_cast<std::size_t>(m_size);
+    auto const row_bytes = std::max<std::size_t>(size * sizeof(Scalar), 1);
+    auto const capacity = std::min(std::max<std::size_t>(memory_budget / row_bytes, 1), std::max<std::size_t>(size, 1));
+
+    m_statistics.capacity = static_cast<int>(capacity);
+
+    m_cache.resize(capacity * size);
+    m_slot_of_row.assign(size, -1);
+    m_row_in_slot.assign(capacity, -1);
+    m_previous.assign(capacity, -1);
+    m_next.assign(capacity, -1);
+  }
+
+  // the most recently requested row refers into the cache, which a copy would not share
+  basic_distance_oracle(basic_distance_oracle const &) = delete;
+  basic_distance_oracle &operator=(basic_distance_oracle const &) = delete;
+
+  basic_distance_oracle(basic_distance_oracle &&) = default;
+  basic_distance_oracle &operator=(basic_distance_oracle &&) = default;
+
+  int rows() const
+  {
+    return m_size;
+  }
+
+  int cols() const
+  {
+    return m_size;
+  }
+
+  Scalar operator()(int i, int j) const
+  {
+    if(j != m_last_row) {
+      m_last_distances = row(j);
+      m_last_row = j;
+    }
+
+    return m_last_distances[i];
+  }
+
+  /**
+   * @return The distances between an object and every object, which remain valid until another row is requested.
+   */
+  Scalar const *row(int object) const
+  {
+    auto slot = m_slot_of_row[object];
+
+    if(slot >= 0) {
+      ++m_statistics.hits;
+      unlink(slot);
+    } else {
+      ++m_statistics.misses;
+
+      if(m_filled < m_statistics.capacity) {
+        // use a slot that has never been filled
+        slot = m_filled++;
+      } else {
+        // evict the least recently used row
+        slot = m_tail;
+        unlink(slot);
+        m_slot_of_row[m_row_in_slot[slot]] = -1;
+      }
+
+      m_row_in_slot[slot] = object;
+      m_slot_of_row[object] = slot;
+
+      // the previous row may have been evicted
+      m_last_row = -1;
+      m_calculate_row(object, slot_data(slot));
+    }
+
+    push_front(slot);
+
+    return slot_data(slot);
+  }
+
+  distance_cache_statistics const &statistics() const
+  {
+    return m_statistics;
+  }
+
+  /**
+   * Reset the hit and miss counters without clearing the cache.
+   */
+  void reset_statistics()
+  {
+    m_statistics.hits = 0;
+    m_statistics.misses = 0;
+  }
+
+private:
+  /**
+   * Create the function that calculates a row of distances, which refers to the objects without copying them.
+   */
+  template<typename Derived, typename Metric>
+  static std::function<void(int, Scalar *)> row_calculator(Eigen::MatrixBase<Derived> const &matrix, Metric metric)
+  {
+    static_assert(std::is_same<typename Derived::Scalar, Scalar>::value,
+        "The objects must have the same scalar type as the distances.");
+    static_assert(static_cast<bool>(Derived::Flags & Eigen::DirectAccessBit),
+        "The objects are read in place, so they must be stored in memory.");
+
+    // a reference to other objects would hold a copy of them, which would not survive the reference being copied
+    if(matrix.innerStride() != 1) {
+      throw std::runtime_error("Error: the oracle requires the elements of each object to be contiguous.");
+    }
+
+    using Buffer = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+    return [objects = detail::observations<Derived>(matrix), metric, object = Buffer(), tile = Buffer()](
+               int row, Scalar *distances) mutable {
+      detail::calculate_oracle_row(objects, row, metric, &object, &tile, distances);
+    };
+  }
+
+  Scalar *slot_data(int slot) const
+  {
+    return m_cache.data() + static_cast<std::size_t>(slot) * m_size;
+  }
+
+  void unlink(int slot) const
+  {
+    auto const previous = m_previous[slot];
+    auto const next = m_next[slot];
+
+    (previous >= 0 ? m_next[previous] : m_head) = next;
+    (next >= 0 ? m_previous[next] : m_tail) = previous;
+  }
+
+  void push_front(int slot) const
+  {
+    m_previous[slot] = -1;
+    m_next[slot] = m_head;
+
+    (m_head >= 0 ? m_previous[m_head] : m_tail) = slot;
+    m_head = slot;
+  }
+
+  /**
+   * The number of objects.
+   */
+  int m_size;
+
+  /**
+   * Calculate the distances between an object and every object, with the metric inlined into the loop.
+   */
+  std::function<void(int, Scalar *)> m_calculate_row;
+
+  /**
+   * The most recently requested row, which is read without updating the cache.
+   */
+  mutable int m_last_row;
+  mutable Scalar const *m_last_distances;
+
+  /**
+   * The cached rows, stored contiguously one slot after another.
+   */
+  mutable std::vector<Scalar> m_cache;
+
+  /**
+   * The slot holding each row, or -1 if the row is not cached, and the row held in each slot.
+   */
+  mutable std::vector<int> m_slot_of_row;
+  mutable std::vector<int> m_row_in_slot;
+
+  /**
+   * The number of slots that have been filled, which are used before any row is evicted.
+   */
+  mutable int m_filled;
+
+  /**
+   * The slots in order of use, as a doubly linked list from the most recently used slot at its head.
+   */
+  mutable std::vector<int> m_previous;
+  mutable std::vector<int> m_next;
+  mutable int m_head;
+  mutable int m_tail;
+
+  mutable distance_cache_statistics m_statistics;
+};
+
+/**
+ * An oracle of double precision distances.
+ */
+using distance_oracle = basic_distance_oracle<double>;
+
+/**
+ * Create an oracle with the same scalar type as a set of objects.
+ *
+ * @param matrix The objects observed, one per row, which are read in place and must outlive the oracle.
+ * @param memory_budget The maximum number of bytes used to cache rows of distances.
+ * @param metric The metric used to calculate the distance between two objects.
+ *
+ * @return The oracle.
+ */
+template<typename Metric = euclidean, typename Derived>
+basic_distance_oracle<typename Derived::Scalar> make_distance_oracle(Eigen::MatrixBase<Derived> const &matrix,
+    std::size_t memory_budget,
+    Metric const &metric = Metric())
+{
+  return basic_distance_oracle<typename Derived::Scalar>(matrix, memory_budget, metric);
+}
+}
+
+#endif //CAPPA_CLUSTER_DISTANCE_ORACLE_HPP
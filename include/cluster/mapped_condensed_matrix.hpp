@@ -0,0 +1,134 @@
+#ifndef CAPPA_CLUSTER_MAPPED_CONDENSED_MATRIX_HPP
+#define CAPPA_CLUSTER_MAPPED_CONDENSED_MATRIX_HPP
+
+#include "cluster/condensed_matrix.hpp"
+#include "cluster/detail/mapped_file.hpp"
+#include "cluster/distance.hpp"
+
+#include <cstddef>
+#include <string>
+
+namespace cluster {
+
+/**
+ * A condensed distance matrix stored in a file and mapped into memory, so that it does not need to fit in RAM.
+ *
+ * The file starts with a small header that records the number of rows and the scalar type, followed by the entries
+ * above the diagonal in the same order as a basic_condensed_matrix. Files are written once by
+ * create_mapped_distance_matrix and can be reopened any number of times, for example to cluster with a different k.
+ *
+ * @tparam T The type of the entries, such as float or double.
+ */
+template<typename T>
+class basic_mapped_condensed_matrix {
+public:
+  using Scalar = T;
+
+  /**
+   * Open a file of condensed distances for reading.
+   *
+   * @param path The file written by create_mapped_distance_matrix.
+   */
+  explicit basic_mapped_condensed_matrix(std::string const &path)
+      : m_file(path)
+      , m_size(detail::read_mapped_header(m_file, sizeof(Scalar)))
+      , m_data(reinterpret_cast<Scalar const *>(m_file.data() + detail::mapped_data_offset))
+  {
+  }
+
+  int rows() const
+  {
+    return m_size;
+  }
+
+  int cols() const
+  {
+    return m_size;
+  }
+
+  /**
+   * @return The number of entries stored above the diagonal.
+   */
+  std::size_t size() const
+  {
+    return m_size > 1 ? static_cast<std::size_t>(m_size) * (m_size - 1) / 2 : 0;
+  }
+
+  Scalar operator()(int i, int j) const
+  {
+    if(i == j) {
+      return Scalar(0);
+    }
+
+    return m_data[detail::condensed_index(static_cast<std::size_t>(m_size), i, j)];
+  }
+
+  Scalar const *data() const
+  {
+    return m_data;
+  }
+
+  /**
+   * Advise the operating system how the distances will be read, which controls how much of the file is read ahead.
+   * Partitioning around medoids advises random access while it reads the distances, and normal access afterwards.
+   */
+  void advise(access_pattern pattern) const
+  {
+    m_file.advise(pattern);
+  }
+
+private:
+  detail::mapped_file m_file;
+  int m_size;
+  Scalar const *m_data;
+};
+
+/**
+ * A memory-mapped condensed matrix of double precision entries.
+ */
+using mapped_condensed_matrix = basic_mapped_condensed_matrix<double>;
+
+/**
+ * Calculate the distance between every pair of rows and write them to a file as a condensed matrix, without holding
+ * the distances in memory. Blocks of rows are calculated in parallel and each block is written to a contiguous region
+ * of the file.
+ *
+ * @param path The file to create, which is replaced if it exists.
+ * @param matrix The objects observed, one per row, with float or double elements.
+ * @param options Options that control how distances are calculated.
+ * @param metric The metric to calculate.
+ *
+ * @return The distances, mapped from the file for reading.
+ */
+template<typename Metric = euclidean, typename Derived>
+basic_mapped_condensed_matrix<typename Derived::Scalar> create_mapped_distance_matrix(std::string const &path,
+    Eigen::MatrixBase<Derived> const &matrix,
+    distance_options const &options = distance_options(),
+    Metric const &metric = Metric())
+{
+  using Scalar = typename Derived::Scalar;
+
+  auto const rows = static_cast<std::size_t>(matrix.rows());
+  auto const entries = rows > 1 ? rows * (rows - 1) / 2 : 0;
+
+  {
+    detail::mapped_file file(path, detail::mapped_data_offset + entries * sizeof(Scalar));
+    detail::write_mapped_header(file, sizeof(Scalar), rows);
+
+    // blocks of rows are written in increasing order, and are not read again
+    file.advise(access_pattern::sequential);
+
+    auto *data = reinterpret_cast<Scalar *>(file.data() + detail::mapped_data_offset);
+
+    detail::calculate_distances(detail::observations<Derived>(matrix), options, metric, [&](int i, int j, Scalar distance) {
+      data[detail::condensed_index(rows, i, j)] = distance;
+    });
+
+    file.sync();
+  }
+
+  return basic_mapped_condensed_matrix<Scalar>(path);
+}
+}
+
+#endif //CAPPA_CLUSTER_MAPPED_CONDENSED_MATRIX_HPP
@@ -0,0 +1,151 @@
+#ifndef CAPPA_CLUSTER_METRIC_HPP
+#define CAPPA_CLUSTER_METRIC_HPP
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+namespace cluster {
+
+/**
+ * Metrics are function objects that calculate the dissimilarity between two objects, given as Eigen vectors with the
+ * same scalar type. They are passed by value as template arguments, so each call is inlined into the loops that
+ * calculate distance matrices. Any function object with the same call signature can be used as a metric.
+ */
+
+/**
+ * The Euclidean distance, ||x - y||.
+ */
+struct euclidean {
+  template<typename Derived1, typename Derived2>
+  typename Derived1::Scalar operator()(Eigen::MatrixBase<Derived1> const &x,
+      Eigen::MatrixBase<Derived2> const &y) const
+  {
+    // the 2D norm is the euclidean distance
+    // see: https://en.wikipedia.org/wiki/Norm_(mathematics)#Euclidean_norm
+    return (x - y).template lpNorm<2>();
+  }
+
+  /**
+   * Calculate the distance from a squared Euclidean distance.
+   */
+  template<typename Scalar>
+  static Scalar from_squared_euclidean(Scalar squared_distance)
+  {
+    return std::sqrt(squared_distance);
+  }
+};
+
+/**
+ * The squared Euclidean distance, ||x - y||^2.
+ */
+struct squared_euclidean {
+  template<typename Derived1, typename Derived2>
+  typename Derived1::Scalar operator()(Eigen::MatrixBase<Derived1> const &x,
+      Eigen::MatrixBase<Derived2> const &y) const
+  {
+    return (x - y).squaredNorm();
+  }
+
+  /**
+   * Calculate the distance from a squared Euclidean distance.
+   */
+  template<typename Scalar>
+  static Scalar from_squared_euclidean(Scalar squared_distance)
+  {
+    return squared_distance;
+  }
+};
+
+/**
+ * The Manhattan (city block) distance, the sum of |x_i - y_i|.
+ */
+struct manhattan {
+  template<typename Derived1, typename Derived2>
+  typename Derived1::Scalar operator()(Eigen::MatrixBase<Derived1> const &x,
+      Eigen::MatrixBase<Derived2> const &y) const
+  {
+    return (x - y).template lpNorm<1>();
+  }
+};
+
+/**
+ * The Chebyshev distance, the maximum of |x_i - y_i|.
+ */
+struct chebyshev {
+  template<typename Derived1, typename Derived2>
+  typename Derived1::Scalar operator()(Eigen::MatrixBase<Derived1> const &x,
+      Eigen::MatrixBase<Derived2> const &y) const
+  {
+    return (x - y).template lpNorm<Eigen::Infinity>();
+  }
+};
+
+/**
+ * The cosine distance, 1 - x.y / (||x|| ||y||). An object of zeros is treated as orthogonal to every other object.
+ */
+struct cosine {
+  template<typename Derived1, typename Derived2>
+  typename Derived1::Scalar operator()(Eigen::MatrixBase<Derived1> const &x,
+      Eigen::MatrixBase<Derived2> const &y) const
+  {
+    using Scalar = typename Derived1::Scalar;
+
+    auto const norms = x.norm() * y.norm();
+    if(norms == Scalar(0)) {
+      return Scalar(1);
+    }
+
+    return Scalar(1) - x.dot(y) / norms;
+  }
+};
+
+/**
+ * The Minkowski distance of order p, (sum of |x_i - y_i|^p)^(1/p), for p >= 1.
+ */
+class minkowski {
+public:
+  explicit minkowski(double p)
+      : m_p(p)
+  {
+    if(p < 1.0) {
+      throw std::runtime_error("Error: the order of a Minkowski distance must be at least one.");
+    }
+  }
+
+  template<typename Derived1, typename Derived2>
+  typename Derived1::Scalar operator()(Eigen::MatrixBase<Derived1> const &x,
+      Eigen::MatrixBase<Derived2> const &y) const
+  {
+    using Scalar = typename Derived1::Scalar;
+
+    auto const sum = (x - y).cwiseAbs().array().pow(static_cast<Scalar>(m_p)).sum();
+    return std::pow(sum, static_cast<Scalar>(1.0 / m_p));
+  }
+
+private:
+  double m_p;
+};
+
+namespace detail {
+
+/**
+ * Whether a metric can be calculated from squared Euclidean distances, and therefore by matrix products.
+ */
+template<typename Metric>
+struct is_euclidean : std::false_type {
+};
+
+template<>
+struct is_euclidean<euclidean> : std::true_type {
+};
+
+template<>
+struct is_euclidean<squared_euclidean> : std::true_type {
+};
+}
+}
+
+#endif //CAPPA_CLUSTER_METRIC_HPP
@@ -1,8 +1,13 @@
 #ifndef CAPPA_CLUSTER_PAM_HPP
 #define CAPPA_CLUSTER_PAM_HPP
 
+#include "cluster/distance.hpp"
+#include "cluster/distance_oracle.hpp"
+#include "cluster/mapped_condensed_matrix.hpp"
+
 #include <Eigen/Dense>
 
+#include <cstdint>
 #include <map>
 #include <set>
 #include <vector>
@@ -27,17 +32,414 @@ struct pam_result {
    * The cluster ID each object was assigned to by the algorithm.
    */
   std::vector<int> classification;
+
+  /**
+   * The number of passes the swap phase made over the candidate swaps.
+   */
+  int passes = 0;
+
+  /**
+   * The number of swaps performed by the swap phase.
+   */
+  int swaps = 0;
+
+  /**
+   * The time taken to choose the initial medoids, in seconds.
+   */
+  double initialization_time = 0.0;
+
+  /**
+   * The time taken by the swap phase, or by the iterations of alternating_medoids, in seconds.
+   */
+  double swap_time = 0.0;
 };
 
+/**
+ * The clustering result after partitioning around medoids, stored in flat arrays.
+ *
+ * Unlike pam_result, the result does not allocate a node per medoid and can be filled again without allocating memory
+ * when it already holds a clustering of the same size.
+ */
+struct flat_pam_result {
+  /**
+   * The objects that were found to be medoids, in increasing order so that the medoid of cluster c is medoids[c].
+   */
+  std::vector<int> medoids;
+
+  /**
+   * The cluster ID each object was assigned to by the algorithm.
+   */
+  std::vector<std::int32_t> labels;
+
+  /**
+   * The distance from each object to the medoid of its cluster.
+   */
+  std::vector<double> distances;
+
+  /**
+   * The sum of the distances from each object to the medoid of its cluster.
+   */
+  double total_dissimilarity = 0.0;
+
+  /**
+   * The number of passes the swap phase made over the candidate swaps.
+   */
+  int passes = 0;
+
+  /**
+   * The number of swaps performed by the swap phase.
+   */
+  int swaps = 0;
+
+  /**
+   * The time taken to choose the initial medoids, in seconds.
+   */
+  double initialization_time = 0.0;
+
+  /**
+   * The time taken by the swap phase, or by the iterations of alternating_medoids, in seconds.
+   */
+  double swap_time = 0.0;
+};
+
+/**
+ * Convert a flat clustering result into a pam_result with the same cluster IDs.
+ */
+pam_result to_pam_result(flat_pam_result const &result);
+
+/**
+ * The strategies available for choosing the initial medoids.
+ */
+enum class init_strategy {
+  /**
+   * Use BUILD for partition_around_medoids and LAB for alternating_medoids, whose iterations take about O(n^2 / k) time
+   * and would be dominated by the O(kn^2) time of BUILD.
+   */
+  automatic,
+
+  /**
+   * Greedily add the medoid that decreases the sum of dissimilarities the most, considering every object (BUILD, see
+   * Kaufman and Rousseeuw, 1990). This takes O(kn^2) time.
+   */
+  build,
+
+  /**
+   * Greedily add medoids as BUILD does, but only evaluate a random subsample of O(sqrt(n)) objects against each other
+   * for each medoid (LAB, see Schubert and Rousseeuw, 2019). This takes O(kn) time and gives a slightly worse start.
+   */
+  lab,
+
+  /**
+   * Choose the first medoid at random and each further medoid at random with a probability proportional to its squared
+   * distance to the nearest medoid (k-means++, see Arthur and Vassilvitskii, 2007). This takes O(kn) time.
+   */
+  k_medoids_plus_plus
+};
+
+/**
+ * The strategies available for choosing which swaps to perform during the swap phase.
+ */
+enum class swap_strategy {
+  /**
+   * Evaluate every swap before performing the most favourable ones.
+   */
+  best,
+
+  /**
+   * Perform a favourable swap as soon as it is found.
+   */
+  eager,
+
+  /**
+   * Evaluate swaps with randomly chosen objects until a number of them in a row are not favourable, restarting from
+   * random medoids and keeping the best clustering found (CLARANS, see Ng and Han, 2002). This examines far fewer swaps
+   * than the other strategies but only finds an approximate local optimum.
+   */
+  randomized
+};
+
+/**
+ * Options that control how medoids are found.
+ */
+struct pam_options {
+  /**
+   * The strategy used for choosing the initial medoids.
+   */
+  init_strategy init = init_strategy::automatic;
+
+  /**
+   * The objects to start from instead of choosing initial medoids, such as the medoids of a previous clustering of
+   * similar data. When given, there must be exactly k distinct objects and the init strategy is not used.
+   */
+  std::vector<int> initial_medoids;
+
+  /**
+   * The strategy used for choosing swaps.
+   */
+  swap_strategy swap = swap_strategy::best;
+
+  /**
+   * The maximum number of swaps, each replacing a different medoid, to perform after each pass of the best strategy.
+   */
+  int swaps_per_pass = 1;
+
+  /**
+   * The number of objects in a row whose swaps are not favourable before the randomized strategy stops searching,
+   * where zero uses 2.5% of the nonselected objects, but at least 250. All swaps of an object with each medoid are
+   * evaluated together.
+   */
+  int max_neighbours = 0;
+
+  /**
+   * The number of times the randomized strategy restarts from random medoids after its first search.
+   */
+  int restarts = 1;
+
+  /**
+   * The seed of the random number generators used by the randomized strategies.
+   */
+  unsigned seed = 0;
+
+  /**
+   * The maximum number of iterations of alternating_medoids.
+   */
+  int max_iterations = 100;
+
+  /**
+   * The number of threads used by BUILD, by the best swap strategy and by alternating_medoids, where zero uses one
+   * thread per hardware thread. The medoids found do not depend on the number of threads.
+   */
+  int threads = 1;
+
+  /**
+   * Treat the dense matrix given to partition_around_medoids as a symmetric matrix of precomputed dissimilarities
+   * between objects, rather than as observations. The dissimilarities are used without being copied.
+   */
+  bool precomputed = false;
+
+  /**
+   * Options that control how the distances between objects are calculated from observations.
+   */
+  distance_options distance;
+};
+
+namespace detail {
+
+/**
+ * Ensure that a clustering can be found for a number of objects, throwing a std::runtime_error if it cannot.
+ */
+void validate(int k, int number_of_objects, pam_options const &options);
+
+/**
+ * Minimize the sum of dissimilarities given as a dense square matrix. This is explicitly instantiated for float and
+ * double dissimilarities in either storage order.
+ */
+template<typename Observations>
+void partition_precomputed(int k, Observations const &matrix, pam_options const &options, flat_pam_result *result);
+
+/**
+ * Run alternating_medoids on dissimilarities given as a dense square matrix. This is explicitly instantiated for float
+ * and double dissimilarities in either storage order.
+ */
+template<typename Observations>
+void alternate_precomputed(int k, Observations const &matrix, pam_options const &options, flat_pam_result *result);
+}
+
+/**
+ * Minimize the sum of precomputed dissimilarities to a set of k medoids. The dissimilarities are used without being
+ * copied.
+ *
+ * @param k The number of clusters.
+ * @param distances The dissimilarities between objects, as float or double.
+ * @param options Options that control how medoids are found.
+ *
+ * @return The clustering found.
+ */
+template<typename Scalar>
+pam_result partition_around_medoids(int k,
+    basic_condensed_matrix<Scalar> const &distances,
+    pam_options const &options = pam_options());
+
+/**
+ * Minimize the sum of distances stored in a memory-mapped file to a set of k medoids. The distances are read from the
+ * file as they are needed.
+ *
+ * @param k The number of clusters.
+ * @param distances The dissimilarities between objects, as float or double.
+ * @param options Options that control how medoids are found.
+ *
+ * @return The clustering found.
+ */
+template<typename Scalar>
+pam_result partition_around_medoids(int k,
+    basic_mapped_condensed_matrix<Scalar> const &distances,
+    pam_options const &options = pam_options());
+
+/**
+ * Minimize the sum of distances to a set of k medoids, calculating rows of distances only when they are needed. The
+ * hit and miss statistics of the oracle show how often rows were recalculated.
+ *
+ * @param k The number of clusters.
+ * @param distances The oracle that calculates and caches distances between objects, as float or double.
+ * @param options Options that control how medoids are found.
+ *
+ * @return The clustering found.
+ */
+template<typename Scalar>
+pam_result partition_around_medoids(int k,
+    basic_distance_oracle<Scalar> const &distances,
+    pam_options const &options = pam_options());
+
+/**
+ * Minimize the sum of precomputed dissimilarities to a set of k medoids, storing the clustering in a flat result.
+ *
+ * @param k The number of clusters.
+ * @param distances The dissimilarities between objects, as float or double.
+ * @param options Options that control how medoids are found.
+ * @param result The clustering found. Its storage is reused, so a result can be passed to many calls without
+ * allocating memory again.
+ */
+template<typename Scalar>
+void partition_around_medoids(int k,
+    basic_condensed_matrix<Scalar> const &distances,
+    pam_options const &options,
+    flat_pam_result *result);
+
+/**
+ * Minimize the sum of distances stored in a memory-mapped file to a set of k medoids, storing the clustering in a flat
+ * result.
+ */
+template<typename Scalar>
+void partition_around_medoids(int k,
+    basic_mapped_condensed_matrix<Scalar> const &distances,
+    pam_options const &options,
+    flat_pam_result *result);
+
+/**
+ * Minimize the sum of distances calculated by an oracle to a set of k medoids, storing the clustering in a flat result.
+ */
+template<typename Scalar>
+void partition_around_medoids(int k,
+    basic_distance_oracle<Scalar> const &distances,
+    pam_options const &options,
+    flat_pam_result *result);
+
+/**
+ * Minimize the sum of dissimilarities to a set of k medoids, storing the clustering in a flat result.
+ *
+ * @param k The number of clusters.
+ * @param matrix The objects observed, one per row, or a square matrix of dissimilarities if options.precomputed is set.
+ * @param options Options that control how medoids are found.
+ * @param metric The metric used to calculate the distances between observations.
+ * @param result The clustering found.
+ */
+template<typename Metric, typename Derived>
+void partition_around_medoids(int k,
+    Eigen::MatrixBase<Derived> const &matrix,
+    pam_options const &options,
+    Metric const &metric,
+    flat_pam_result *result)
+{
+  detail::validate(k, static_cast<int>(matrix.rows()), options);
+
+  if(options.precomputed) {
+    detail::partition_precomputed(k, detail::observations<Derived>(matrix), options, result);
+    return;
+  }
+
+  // calculate the distances between observations, storing each distance once
+  partition_around_medoids(k, calculate_condensed_distance_matrix(matrix, options.distance, metric), options, result);
+}
+
 /**
  * Minimize the sum of dissimilarities to a set of k medoids.
  *
  * @param k The number of clusters.
- * @param matrix The objects observed.
+ * @param matrix The objects observed, one per row, or a square matrix of dissimilarities if options.precomputed is set.
+ * The elements may be float or double; distances are calculated and stored with the same precision. Matrices in either
+ * storage order, maps over external buffers and blocks of them are read in place.
+ * @param options Options that control how medoids are found.
+ * @param metric The metric used to calculate the distances between observations.
+ *
+ * @return The clustering found.
+ */
+template<typename Metric = euclidean, typename Derived>
+pam_result partition_around_medoids(int k,
+    Eigen::MatrixBase<Derived> const &matrix,
+    pam_options const &options = pam_options(),
+    Metric const &metric = Metric())
+{
+  flat_pam_result result;
+  partition_around_medoids(k, matrix, options, metric, &result);
+
+  return to_pam_result(result);
+}
+
+/**
+ * Find k medoids by alternating between assigning each object to its nearest medoid and replacing the medoid of each
+ * cluster with the member that minimizes the sum of dissimilarities within the cluster (Park and Jun, 2009).
+ *
+ * Each update only reads the distances within a cluster, so an iteration takes about O(n^2 / k) time, and clusters are
+ * updated in parallel using options.threads. This is much faster than partition_around_medoids but usually finds a
+ * worse clustering. The initial medoids are options.initial_medoids if given, or are chosen by options.init, which
+ * chooses them with LAB by default. Selecting init_strategy::build explicitly takes O(kn^2) time, which usually takes
+ * longer than all iterations together.
+ *
+ * @param k The number of clusters.
+ * @param distances The dissimilarities between objects, as float or double.
+ * @param options Options that control how medoids are found.
+ *
+ * @return The clustering found, where passes counts the iterations and swaps counts the medoids that were replaced.
+ */
+template<typename Scalar>
+pam_result alternating_medoids(int k,
+    basic_condensed_matrix<Scalar> const &distances,
+    pam_options const &options = pam_options());
+
+/**
+ * Find k medoids by alternating assignment and medoid updates, calculating rows of distances only when they are needed.
+ * The clusters are updated by one thread, since the oracle is not thread-safe.
+ */
+template<typename Scalar>
+pam_result alternating_medoids(int k,
+    basic_distance_oracle<Scalar> const &distances,
+    pam_options const &options = pam_options());
+
+/**
+ * Find k medoids by alternating assignment and medoid updates, reading distances from a memory-mapped file.
+ */
+template<typename Scalar>
+pam_result alternating_medoids(int k,
+    basic_mapped_condensed_matrix<Scalar> const &distances,
+    pam_options const &options = pam_options());
+
+/**
+ * Find k medoids by alternating assignment and medoid updates.
+ *
+ * @param k The number of clusters.
+ * @param matrix The objects observed, one per row, or a square matrix of dissimilarities if options.precomputed is set.
+ * @param options Options that control how medoids are found.
+ * @param metric The metric used to calculate the distances between observations.
  *
  * @return The clustering found.
  */
-pam_result partition_around_medoids(int k, Eigen::MatrixXd const &matrix);
+template<typename Metric = euclidean, typename Derived>
+pam_result alternating_medoids(int k,
+    Eigen::MatrixBase<Derived> const &matrix,
+    pam_options const &options = pam_options(),
+    Metric const &metric = Metric())
+{
+  detail::validate(k, static_cast<int>(matrix.rows()), options);
+
+  if(options.precomputed) {
+    flat_pam_result result;
+    detail::alternate_precomputed(k, detail::observations<Derived>(matrix), options, &result);
+
+    return to_pam_result(result);
+  }
+
+  return alternating_medoids(k, calculate_condensed_distance_matrix(matrix, options.distance, metric), options);
+}
 }
 
 #endif //CAPPA_CLUSTER_PAM_HPP
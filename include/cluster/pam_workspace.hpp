@@ -0,0 +1,125 @@
+#ifndef CAPPA_CLUSTER_PAM_WORKSPACE_HPP
+#define CAPPA_CLUSTER_PAM_WORKSPACE_HPP
+
+#include "cluster/condensed_matrix.hpp"
+#include "cluster/distance.hpp"
+#include "cluster/metric.hpp"
+#include "cluster/pam.hpp"
+
+#include <Eigen/Dense>
+
+#include <memory>
+#include <type_traits>
+
+namespace cluster {
+
+/**
+ * The storage used to partition objects around medoids, kept between calls so that many similar problems can be
+ * clustered without allocating memory for each of them.
+ *
+ * A workspace owns the distance matrix, the clustering state and the result. Each buffer grows to fit the largest
+ * problem clustered so far and is reused for any problem of at most the same size. Once a workspace has clustered a
+ * problem, clustering another problem with at most as many objects and medoids does not allocate memory when BUILD
+ * chooses the initial medoids, the best or eager swap strategy is used and one thread is used. The distances must be
+ * precomputed or calculated directly: the matrix product method reuses its buffers too, but Eigen allocates memory for
+ * the products of objects with more than about 32 dimensions.
+ *
+ * A workspace must not be shared between threads, but each thread may use its own workspace.
+ *
+ * @tparam T The type of the distances, such as float or double.
+ */
+template<typename T>
+class basic_pam_workspace {
+public:
+  using Scalar = T;
+
+  basic_pam_workspace();
+  ~basic_pam_workspace();
+
+  basic_pam_workspace(basic_pam_workspace const &) = delete;
+  basic_pam_workspace &operator=(basic_pam_workspace const &) = delete;
+
+  basic_pam_workspace(basic_pam_workspace &&) noexcept;
+  basic_pam_workspace &operator=(basic_pam_workspace &&) noexcept;
+
+  /**
+   * Minimize the sum of precomputed dissimilarities to a set of k medoids.
+   *
+   * @param k The number of clusters.
+   * @param distances The dissimilarities between objects.
+   * @param options Options that control how medoids are found.
+   *
+   * @return The clustering found, which is replaced when the workspace is used again.
+   */
+  flat_pam_result const &partition_around_medoids(int k,
+      basic_condensed_matrix<Scalar> const &distances,
+      pam_options const &options = pam_options());
+
+  /**
+   * Minimize the sum of dissimilarities to a set of k medoids, calculating the distances between observations into
+   * the distance matrix of the workspace.
+   *
+   * @param k The number of clusters.
+   * @param matrix The objects observed, one per row, or a square matrix of dissimilarities if options.precomputed is
+   * set. The elements must have the same type as the workspace.
+   * @param options Options that control how medoids are found.
+   * @param metric The metric used to calculate the distances between observations.
+   *
+   * @return The clustering found, which is replaced when the workspace is used again.
+   */
+  template<typename Metric = euclidean, typename Derived>
+  flat_pam_result const &partition_around_medoids(int k,
+      Eigen::MatrixBase<Derived> const &matrix,
+      pam_options const &options = pam_options(),
+      Metric const &metric = Metric())
+  {
+    static_assert(std::is_same<typename Derived::Scalar, Scalar>::value,
+        "The observations must have the same scalar type as the workspace.");
+
+    detail::validate(k, static_cast<int>(matrix.rows()), options);
+
+    if(options.precomputed) {
+      partition_precomputed(k, detail::observations<Derived>(matrix), options);
+      return m_result;
+    }
+
+    m_distances.resize(static_cast<int>(matrix.rows()));
+
+    detail::calculate_distances(detail::observations<Derived>(matrix),
+        options.distance,
+        metric,
+        [this](int i, int j, Scalar distance) { m_distances.set(i, j, distance); });
+
+    return partition_around_medoids(k, m_distances, options);
+  }
+
+  /**
+   * @return The clustering found by the most recent call.
+   */
+  flat_pam_result const &result() const
+  {
+    return m_result;
+  }
+
+private:
+  template<typename Observations>
+  void partition_precomputed(int k, Observations const &matrix, pam_options const &options);
+
+  struct state;
+
+  /**
+   * The clustering state, which is only defined where the algorithm is compiled.
+   */
+  std::unique_ptr<state> m_state;
+
+  basic_condensed_matrix<Scalar> m_distances;
+  flat_pam_result m_result;
+};
+
+/**
+ * A workspace for double precision distances.
+ */
+using pam_workspace = basic_pam_workspace<double>;
+}
+
+#endif //CAPPA_CLUSTER_PAM_WORKSPACE_HPP
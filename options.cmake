@@ -1,7 +1,19 @@
 # potential build options
 
+option(
+  CLUSTER_ENABLE_THREADS
+  "Allow the cluster library to distribute work over multiple threads"
+  ON
+)
+
 option(
   CLUSTER_BUILD_EXAMPLES
   "Build the example executables that use the cluster library"
   OFF
+)
+
+option(
+  CLUSTER_BUILD_BENCHMARKS
+  "Build the benchmark executables that measure the cluster library"
+  OFF
 )
\ No newline at end of file
@@ -1,24 +1,19 @@
 #include "cluster/distance.hpp"
 
 namespace cluster {
+namespace detail {
 
-double euclidean_distance(Eigen::VectorXd const &vector1, Eigen::VectorXd const &vector2)
-{
-  // the 2D norm is the euclidean distance
-  // see: https://en.wikipedia.org/wiki/Norm_(mathematics)#Euclidean_norm
-  return (vector1 - vector2).lpNorm<2>();
-}
-
-Eigen::MatrixXd calculate_distance_matrix(Eigen::MatrixXd const &matrix)
-{
-  Eigen::MatrixXd distance_matrix = Eigen::MatrixXd::Constant(matrix.rows(), matrix.rows(), 0.0);
+#define CLUSTER_INSTANTIATE_DISTANCE_MATRICES(Scalar, Observations)                          \
+  template Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> calculate_distance_matrix( \
+      Observations<Scalar> const &, distance_options const &, euclidean const &);            \
+  template basic_condensed_matrix<Scalar> calculate_condensed_distance_matrix(               \
+      Observations<Scalar> const &, distance_options const &, euclidean const &);
 
-  for(int i = 0; i < matrix.rows(); ++i) {
-    for(int j = 0; j < matrix.rows(); ++j) {
-      distance_matrix(i, j) = euclidean_distance(matrix.row(i), matrix.row(j));
-    }
-  }
+CLUSTER_INSTANTIATE_DISTANCE_MATRICES(float, column_major_observations)
+CLUSTER_INSTANTIATE_DISTANCE_MATRICES(float, row_major_observations)
+CLUSTER_INSTANTIATE_DISTANCE_MATRICES(double, column_major_observations)
+CLUSTER_INSTANTIATE_DISTANCE_MATRICES(double, row_major_observations)
 
-  return distance_matrix;
+#undef CLUSTER_INSTANTIATE_DISTANCE_MATRICES
 }
 }
@@ -0,0 +1,213 @@
+#include "cluster/detail/mapped_file.hpp"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CLUSTER_HAS_MMAP
+#endif
+
+namespace cluster {
+namespace detail {
+
+namespace {
+
+char const magic[8] = {'C', 'L', 'U', 'S', 'T', 'E', 'R', 'D'};
+std::uint32_t const version = 1;
+
+#ifdef CLUSTER_HAS_MMAP
+char *map(int descriptor, std::size_t size, int protection)
+{
+  if(size == 0) {
+    return nullptr;
+  }
+
+  void *data = mmap(nullptr, size, protection, MAP_SHARED, descriptor, 0);
+  if(data == MAP_FAILED) {
+    ::close(descriptor);
+    throw std::runtime_error("Error: could not map the distance file into memory.");
+  }
+
+  return static_cast<char *>(data);
+}
+#endif
+}
+
+mapped_file::mapped_file(std::string const &path, std::size_t size)
+    : m_descriptor(-1)
+    , m_data(nullptr)
+    , m_size(size)
+{
+#ifdef CLUSTER_HAS_MMAP
+  m_descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(m_descriptor < 0) {
+    throw std::runtime_error("Error: could not create the distance file " + path + ".");
+  }
+
+  if(ftruncate(m_descriptor, static_cast<off_t>(size)) != 0) {
+    ::close(m_descriptor);
+    throw std::runtime_error("Error: could not allocate the distance file " + path + ".");
+  }
+
+  m_data = map(m_descriptor, size, PROT_READ | PROT_WRITE);
+#else
+  (void)path;
+  throw std::runtime_error("Error: memory-mapped files are not supported on this platform.");
+#endif
+}
+
+mapped_file::mapped_file(std::string const &path)
+    : m_descriptor(-1)
+    , m_data(nullptr)
+    , m_size(0)
+{
+#ifdef CLUSTER_HAS_MMAP
+  m_descriptor = open(path.c_str(), O_RDONLY);
+  if(m_descriptor < 0) {
+    throw std::runtime_error("Error: could not open the distance file " + path + ".");
+  }
+
+  struct stat status;
+  if(fstat(m_descriptor, &status) != 0) {
+    ::close(m_descriptor);
+    throw std::runtime_error("Error: could not read the size of the distance file " + path + ".");
+  }
+
+  m_size = static_cast<std::size_t>(status.st_size);
+  m_data = map(m_descriptor, m_size, PROT_READ);
+#else
+  (void)path;
+  throw std::runtime_error("Error: memory-mapped files are not supported on this platform.");
+#endif
+}
+
+mapped_file::~mapped_file()
+{
+  close();
+}
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+    : m_descriptor(other.m_descriptor)
+    , m_data(other.m_data)
+    , m_size(other.m_size)
+{
+  other.m_descriptor = -1;
+  other.m_data = nullptr;
+  other.m_size = 0;
+}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept
+{
+  if(this != &other) {
+    close();
+
+    std::swap(m_descriptor, other.m_descriptor);
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+  }
+
+  return *this;
+}
+
+void mapped_file::advise(access_pattern pattern) const
+{
+#ifdef CLUSTER_HAS_MMAP
+  if(m_data == nullptr) {
+    return;
+  }
+
+  int advice = MADV_NORMAL;
+  switch(pattern) {
+  case access_pattern::normal:
+    advice = MADV_NORMAL;
+    break;
+  case access_pattern::sequential:
+    advice = MADV_SEQUENTIAL;
+    break;
+  case access_pattern::random:
+    advice = MADV_RANDOM;
+    break;
+  case access_pattern::will_need:
+    advice = MADV_WILLNEED;
+    break;
+  }
+
+  // the advice is only a hint, so a failure is not an error
+  madvise(m_data, m_size, advice);
+#else
+  (void)pattern;
+#endif
+}
+
+void mapped_file::sync() const
+{
+#ifdef CLUSTER_HAS_MMAP
+  if(m_data != nullptr && msync(m_data, m_size, MS_SYNC) != 0) {
+    throw std::runtime_error("Error: could not write the distance file.");
+  }
+#endif
+}
+
+void mapped_file::close()
+{
+#ifdef CLUSTER_HAS_MMAP
+  if(m_data != nullptr) {
+    munmap(m_data, m_size);
+  }
+
+  if(m_descriptor >= 0) {
+    ::close(m_descriptor);
+  }
+#endif
+
+  m_descriptor = -1;
+  m_data = nullptr;
+  m_size = 0;
+}
+
+void write_mapped_header(mapped_file const &file, std::size_t scalar_size, std::size_t rows)
+{
+  mapped_header header;
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.scalar_size = static_cast<std::uint32_t>(scalar_size);
+  header.rows = rows;
+
+  std::memcpy(file.data(), &header, sizeof(header));
+}
+
+int read_mapped_header(mapped_file const &file, std::size_t scalar_size)
+{
+  mapped_header header;
+
+  if(file.size() < mapped_data_offset) {
+    throw std::runtime_error("Error: the distance file is too small to contain a header.");
+  }
+
+  std::memcpy(&header, file.data(), sizeof(header));
+
+  if(std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version) {
+    throw std::runtime_error("Error: the file does not contain condensed distances.");
+  } else if(header.scalar_size != scalar_size) {
+    throw std::runtime_error("Error: the distance file was written with a different scalar type.");
+  } else if(header.rows > static_cast<std::uint64_t>(std::numeric_limits<int>::max())) {
+    throw std::runtime_error("Error: the distance file has too many rows.");
+  }
+
+  auto const rows = static_cast<std::size_t>(header.rows);
+  auto const entries = rows > 1 ? rows * (rows - 1) / 2 : 0;
+
+  if(file.size() < mapped_data_offset + entries * scalar_size) {
+    throw std::runtime_error("Error: the distance file is truncated.");
+  }
+
+  return static_cast<int>(rows);
+}
+}
+}
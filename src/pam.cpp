@@ -1,316 +1,1578 @@
 #include "cluster/pam.hpp"
+#include "pam_data.hpp"
 
 #include "cluster/distance.hpp"
+#include "cluster/pam_workspace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
 
 namespace cluster {
 
 /**
- * Data used during the PAM algorithm.
+ * The number of threads that may read a type of distances at the same time. An oracle caches rows as it is read, so
+ * it is only read by one thread.
  */
-struct pam_data {
-  std::set<int> medoids;
-  std::set<int> nonselected;
-  std::vector<int> classification;
-  std::vector<int> second_closest_medoid;
-  double total_dissimilarity;
+template<typename Distances>
+int concurrent_readers(Distances const &, int const threads)
+{
+  return threads;
+}
 
-  pam_data(int number_of_objects, int initial_medoid)
-      : classification(number_of_objects, initial_medoid)
-      , second_closest_medoid(number_of_objects, -1)
-      , total_dissimilarity(0.0)
-  {
-    for(int i = 0; i < number_of_objects; ++i) {
-      nonselected.insert(nonselected.end(), i);
-    }
+template<typename Scalar>
+int concurrent_readers(basic_distance_oracle<Scalar> const &, int)
+{
+  return 1;
+}
 
-    medoids.insert(initial_medoid);
-    nonselected.erase(initial_medoid);
+/**
+ * Call a function with each object j and the distance between j and h, in increasing order of j.
+ */
+template<typename Distances, typename Function>
+void for_each_distance(Distances const &distances, int const h, Function &&function)
+{
+  for(int j = 0; j < distances.rows(); ++j) {
+    function(j, distances(j, h));
   }
+}
 
-  void assign_medoid(int object, int medoid)
-  {
-    classification[object] = medoid;
-  }
+/**
+ * Condensed storage reads the distances to h directly, one per row before the diagonal and contiguously after it,
+ * instead of computing the position of every entry.
+ */
+template<typename Scalar, typename Function>
+void for_each_distance(basic_condensed_matrix<Scalar> const &distances, int const h, Function &&function)
+{
+  detail::for_each_condensed_entry(distances.data(), distances.rows(), h, function);
+}
 
-  void add_medoid(int medoid)
-  {
-    medoids.insert(medoid);
-    nonselected.erase(medoid);
+template<typename Scalar, typename Function>
+void for_each_distance(basic_mapped_condensed_matrix<Scalar> const &distances, int const h, Function &&function)
+{
+  detail::for_each_condensed_entry(distances.data(), distances.rows(), h, function);
+}
 
-    assign_medoid(medoid, medoid);
+/**
+ * Add up the distances between each object of a range and every object, adding the distances of each object in the
+ * same order on every call.
+ *
+ * @param distances The distance matrix.
+ * @param first The first object of the range.
+ * @param last The object after the last object of the range.
+ * @param sums Storage for the sum of each object, which is set for the objects of the range.
+ */
+template<typename Distances>
+void sum_distances(Distances const &distances, int const first, int const last, std::vector<double> *sums)
+{
+  for(int h = first; h < last; ++h) {
+    auto &sum = (*sums)[h];
+    sum = 0.0;
+    for_each_distance(distances, h, [&sum](int, typename Distances::Scalar const distance) { sum += distance; });
   }
+}
 
-  void swap_medoid(int old_medoid, int new_medoid)
-  {
-    medoids.erase(old_medoid);
-    nonselected.insert(old_medoid);
+/**
+ * A column of dense dissimilarities is contiguous, so it is summed as one vector.
+ */
+template<typename Scalar>
+void sum_distances(detail::column_major_observations<Scalar> const &distances,
+    int const first,
+    int const last,
+    std::vector<double> *sums)
+{
+  for(int h = first; h < last; ++h) {
+    (*sums)[h] = distances.col(h).template cast<double>().sum();
+  }
+}
 
-    add_medoid(new_medoid);
+/**
+ * The distances to h in condensed storage are the entries (i, h) of the rows before h, one per row, followed by the
+ * contiguous entries of row h after the diagonal. Rather than reading one entry of every earlier row for each object,
+ * the rows are read in order and the part of each row that lies in the range is added to the sums of the range as one
+ * vector, before the rest of each row of the range is summed as one vector. Each sum still adds the distances of the
+ * earlier rows in order, followed by the sum of its own row, so it does not depend on the ranges.
+ */
+template<typename Scalar>
+void sum_condensed_distances(Scalar const *data,
+    int const size,
+    int const first,
+    int const last,
+    std::vector<double> *sums)
+{
+  using vector = Eigen::Map<Eigen::Matrix<Scalar, Eigen::Dynamic, 1> const>;
 
-    for(auto &medoid : classification) {
-      if(medoid == old_medoid) {
-        medoid = new_medoid;
-      }
-    }
+  Eigen::Map<Eigen::VectorXd> range_sums(sums->data() + first, last - first);
+  range_sums.setZero();
 
-    for(auto &medoid : second_closest_medoid) {
-      if(medoid == old_medoid) {
-        medoid = new_medoid;
-      }
-    }
+  for(int i = 0; i + 1 < last; ++i) {
+    auto const column = std::max(i + 1, first);
+    auto const row = data + detail::condensed_index(static_cast<std::size_t>(size), i, column);
+    range_sums.segment(column - first, last - column) += vector(row, last - column).template cast<double>();
   }
-};
+
+  for(int h = first; h < last; ++h) {
+    auto const row = data + detail::condensed_index(static_cast<std::size_t>(size), h, h + 1);
+    (*sums)[h] += vector(row, size - h - 1).template cast<double>().sum();
+  }
+}
+
+template<typename Scalar>
+void sum_distances(basic_condensed_matrix<Scalar> const &distances,
+    int const first,
+    int const last,
+    std::vector<double> *sums)
+{
+  sum_condensed_distances(distances.data(), distances.rows(), first, last, sums);
+}
+
+template<typename Scalar>
+void sum_distances(basic_mapped_condensed_matrix<Scalar> const &distances,
+    int const first,
+    int const last,
+    std::vector<double> *sums)
+{
+  sum_condensed_distances(distances.data(), distances.rows(), first, last, sums);
+}
+
+/**
+ * Advise how a type of distances is about to be read. Only memory-mapped distances use the advice, which controls how
+ * much of the file the operating system reads ahead.
+ */
+template<typename Distances>
+void advise(Distances const &, access_pattern)
+{
+}
+
+template<typename Scalar>
+void advise(basic_mapped_condensed_matrix<Scalar> const &distances, access_pattern const pattern)
+{
+  distances.advise(pattern);
+}
+
+namespace {
+
+/**
+ * The number of contiguous ranges to divide the objects into when they are processed by a number of threads. A few
+ * ranges are used per thread so that threads which finish early can take another range.
+ */
+int number_of_ranges(int const number_of_objects, int const workers)
+{
+  return workers > 1 ? std::min(4 * workers, number_of_objects) : 1;
+}
+
+/**
+ * @return The first object of a range, which is also the object after the last object of the previous range.
+ */
+int range_begin(int const number_of_objects, int const range, int const ranges)
+{
+  return static_cast<int>(static_cast<long long>(number_of_objects) * range / ranges);
+}
+}
 
 /**
  * The initial medoid is the object with the minimum sum of dissimilarities to all other objects.
  *
+ * The sums of contiguous ranges of objects are calculated in parallel. The distances of each object are summed in a
+ * fixed order, so every sum is the same regardless of the number of threads. Contiguous distances, such as the entries
+ * of a condensed row, are summed as vectors, and each row of a lazily calculated matrix is calculated once.
+ *
  * @param distances The distance matrix.
+ * @param threads The number of threads to use, where zero uses one thread per hardware thread.
+ * @param sums_of_dissimilarities Storage for the sum of dissimilarities of each object.
  *
  * @return The index of the object that was found to be the medoid.
  */
-int find_initial_medoid(Eigen::MatrixXd const &distances)
+template<typename Distances>
+int find_initial_medoid(Distances const &distances, int const threads, std::vector<double> *sums_of_dissimilarities)
 {
-  Eigen::VectorXd sum_of_dissimilarities(distances.rows());
+  auto const number_of_objects = static_cast<int>(distances.rows());
+  auto const workers = detail::thread_count(concurrent_readers(distances, threads));
+  auto const ranges = number_of_ranges(number_of_objects, workers);
 
-  for(int i = 0; i < distances.rows(); ++i) {
-    sum_of_dissimilarities(i) = distances.row(i).sum();
-  }
+  sums_of_dissimilarities->resize(number_of_objects);
+
+  detail::parallel_for(ranges, workers, [&](int range) {
+    sum_distances(distances,
+        range_begin(number_of_objects, range, ranges),
+        range_begin(number_of_objects, range + 1, ranges),
+        sums_of_dissimilarities);
+  });
 
-  int initial_medoid;
-  sum_of_dissimilarities.minCoeff(&initial_medoid);
+  double minimum_sum = std::numeric_limits<double>::max();
+  int initial_medoid = 0;
+
+  for(int i = 0; i < number_of_objects; ++i) {
+    if((*sums_of_dissimilarities)[i] < minimum_sum) {
+      minimum_sum = (*sums_of_dissimilarities)[i];
+      initial_medoid = i;
+    }
+  }
 
   return initial_medoid;
 }
 
+/**
+ * Calculates the decrease of the objective function if a nonselected object i was selected as a medoid.
+ *
+ * @param distances The distance matrix.
+ * @param i A nonselected object.
+ * @param clustering The current clustering state.
+ *
+ * @return The gain of selecting i.
+ */
+template<typename Distances>
+double calculate_gain(Distances const &distances, int const i, pam_data_for<Distances> const &clustering)
+{
+  using Scalar = typename Distances::Scalar;
+
+  double gain = 0.0;
+
+  // consider another nonselected object j
+  for_each_distance(distances, i, [&](int const j, Scalar const d_j_i) {
+    if(j == i || clustering.is_medoid(j)) {
+      return;
+    }
+
+    // the dissimilarity between j and its currently assigned cluster
+    auto const D_j = clustering.nearest_distance[j];
+
+    // if the difference of these dissimliarities is positive, it contributes to the selection of i
+    gain += std::max(D_j - d_j_i, Scalar(0));
+  });
+
+  return gain;
+}
+
 /**
  * The next medoid is the the a nonselected object that decreases the objective function the most.
  *
+ * The gains of contiguous ranges of objects are calculated in parallel, and the best object of each range is combined
+ * in order, so the lowest object is chosen on ties regardless of the number of threads.
+ *
  * @param distances The distance matrix.
  * @param clustering The current clustering state.
+ * @param threads The number of threads to use, where zero uses one thread per hardware thread.
+ * @param best_candidates Storage for the best candidate of each range of objects.
  *
  * @return The index of the object that was found to be the medoid.
  */
-int find_next_medoid(Eigen::MatrixXd const &distances, pam_data const &clustering)
+template<typename Distances>
+int find_next_medoid(Distances const &distances,
+    pam_data_for<Distances> const &clustering,
+    int const threads,
+    std::vector<build_candidate> *best_candidates)
 {
-  double maximum_gain = std::numeric_limits<double>::lowest();
-  int next_medoid = 0;
+  auto const number_of_objects = static_cast<int>(distances.rows());
+  auto const workers = detail::thread_count(concurrent_readers(distances, threads));
+  auto const ranges = number_of_ranges(number_of_objects, workers);
 
-  // consider an object i which has not been selected yet
-  for(auto const i : clustering.nonselected) {
-    auto nonselected = clustering.nonselected;
-    nonselected.erase(i);
+  best_candidates->assign(ranges, {std::numeric_limits<double>::lowest(), 0});
 
-    // track the potential gain of selecting i as a new medoid
-    double gain = 0.0;
+  detail::parallel_for(ranges, workers, [&](int range) {
+    auto &best = (*best_candidates)[range];
 
-    // consider another nonselected object j
-    for(auto const j : nonselected) {
-      // calculate the dissimilarity between j and its currently assigned cluster
-      double const D_j = distances(j, clustering.classification[j]);
-      // calculate the dissimilarity between j and i
-      double const d_j_i = distances(j, i);
+    // consider an object i which has not been selected yet
+    for(int i = range_begin(number_of_objects, range, ranges); i < range_begin(number_of_objects, range + 1, ranges);
+        ++i) {
+      if(clustering.is_medoid(i)) {
+        continue;
+      }
 
-      // if the difference of these dissimliarities is positive, it contributes to the selection of i
-      gain += std::max(D_j - d_j_i, 0.0);
+      // choose the nonselected object that maximizes the gain
+      auto const gain = calculate_gain(distances, i, clustering);
+      if(gain > best.gain) {
+        best = {gain, i};
+      }
     }
+  });
 
-    // choose the nonselected object that maximizes the gain
-    if(gain > maximum_gain) {
-      maximum_gain = gain;
-      next_medoid = i;
+  // a later range only wins with a strictly larger gain
+  auto next_medoid = best_candidates->front();
+  for(auto const &best : *best_candidates) {
+    if(best.gain > next_medoid.gain) {
+      next_medoid = best;
     }
   }
 
-  return next_medoid;
+  return next_medoid.object;
+}
+
+/**
+ * Determine if a medoid is closer to an object than another medoid, preferring the medoid with the lowest index when
+ * they are equally distant.
+ */
+template<typename Scalar>
+bool is_closer(Scalar distance, int medoid, Scalar other_distance, int other_medoid)
+{
+  return distance < other_distance || (distance == other_distance && medoid < other_medoid);
 }
 
 /**
- * Reassign objects in the current clustering for the new medoid.
+ * Make a medoid the nearest or second nearest medoid of an object if it is closer than the current ones.
  *
- * @param distances The distance matrix.
+ * @param object The object to assign.
+ * @param index The position of the medoid.
+ * @param distance The distance between the object and the medoid.
  * @param clustering The clustering state to modify.
  */
-void reclassify_objects(Eigen::MatrixXd const &distances, pam_data *clustering)
+template<typename Scalar>
+void consider_medoid(int const object, int const index, Scalar const distance, pam_data<Scalar> *clustering)
 {
-  // reset the total dissimilarity
-  clustering->total_dissimilarity = 0.0;
+  auto const medoid = clustering->medoids[index];
+  auto const nearest_medoid = clustering->medoid_at(clustering->nearest[object]);
+  auto const second_medoid = clustering->medoid_at(clustering->second[object]);
 
-  for(int object = 0; object < distances.rows(); ++object) {
-    double closest_distance = std::numeric_limits<double>::max();
-    double second_closest_distance = std::numeric_limits<double>::max();
+  // a medoid is always the nearest medoid to itself
+  if(medoid == object
+      || (nearest_medoid != object
+             && is_closer(distance, medoid, clustering->nearest_distance[object], nearest_medoid))) {
+    clustering->second[object] = clustering->nearest[object];
+    clustering->second_distance[object] = clustering->nearest_distance[object];
 
-    int closest_medoid = -1;
-    int second_closest_medoid = -1;
+    clustering->nearest[object] = index;
+    clustering->nearest_distance[object] = distance;
+  } else if(is_closer(distance, medoid, clustering->second_distance[object], second_medoid)) {
+    clustering->second[object] = index;
+    clustering->second_distance[object] = distance;
+  }
+}
 
-    for(auto const medoid : clustering->medoids) {
-      double const distance = distances(object, medoid);
+/**
+ * Forget the nearest and second nearest medoids of an object, so that every medoid can be considered again.
+ */
+template<typename Scalar>
+void unassign_object(int const object, pam_data<Scalar> *clustering)
+{
+  clustering->nearest[object] = -1;
+  clustering->second[object] = -1;
+  clustering->nearest_distance[object] = std::numeric_limits<Scalar>::max();
+  clustering->second_distance[object] = std::numeric_limits<Scalar>::max();
+}
 
-      if(distance < closest_distance || clustering->classification[medoid] == object) {
-        second_closest_distance = closest_distance;
-        second_closest_medoid = closest_medoid;
+/**
+ * @return The sum of the distances from every object to its nearest medoid, added in order of the objects.
+ */
+template<typename Scalar>
+double sum_nearest_distances(pam_data<Scalar> const &clustering)
+{
+  double total_dissimilarity = 0.0;
+  for(auto const distance : clustering.nearest_distance) {
+    total_dissimilarity += distance;
+  }
 
-        closest_distance = distance;
-        closest_medoid = medoid;
-      } else if(distance < second_closest_distance) {
-        second_closest_distance = distance;
-        second_closest_medoid = medoid;
-      }
-    }
+  return total_dissimilarity;
+}
+
+template<typename Distances>
+void reclassify_objects(Distances const &distances, pam_data_for<Distances> *clustering)
+{
+  auto const number_of_objects = static_cast<int>(distances.rows());
+  auto const number_of_medoids = static_cast<int>(clustering->medoids.size());
 
-    clustering->classification[object] = closest_medoid;
-    clustering->second_closest_medoid[object] = second_closest_medoid;
-    clustering->total_dissimilarity += closest_distance;
+  for(int object = 0; object < number_of_objects; ++object) {
+    unassign_object(object, clustering);
   }
+
+  // every object considers one medoid at a time, so the distances to each medoid are read together (and a lazily
+  // calculated matrix calculates k rows) rather than the distances from each object to every medoid
+  for(int index = 0; index < number_of_medoids; ++index) {
+    for_each_distance(distances,
+        clustering->medoids[index],
+        [&](int const object, typename Distances::Scalar const distance) {
+          consider_medoid(object, index, distance, clustering);
+        });
+  }
+
+  clustering->total_dissimilarity = sum_nearest_distances(*clustering);
 }
 
 /**
- * The first phase of pam produces an initial clustering for k objects.
+ * Select an additional medoid and assign each object to it if it is nearer than the object's current nearest or second
+ * nearest medoid. Only the distances to the new medoid are examined.
  *
- * @param k The number of initial clusters to find.
- * @param matrix The observations.
+ * @param distances The distance matrix.
+ * @param medoid The nonselected object to add as a medoid.
+ * @param clustering The clustering state to modify.
+ */
+template<typename Distances>
+void add_medoid(Distances const &distances, int const medoid, pam_data_for<Distances> *clustering)
+{
+  clustering->add_medoid(medoid);
+  clustering->total_dissimilarity = 0.0;
+
+  auto const index = clustering->medoid_index[medoid];
+
+  for_each_distance(distances, medoid, [&](int const object, typename Distances::Scalar const distance) {
+    consider_medoid(object, index, distance, clustering);
+    clustering->total_dissimilarity += clustering->nearest_distance[object];
+  });
+}
+
+/**
+ * Choose k medoids greedily, where each medoid decreases the objective function the most (BUILD).
  *
- * @return An initial clustering of observations to k objects.
+ * @param k The number of initial clusters to find.
+ * @param distances The distance matrix.
+ * @param threads The number of threads used to evaluate candidates, where zero uses one thread per hardware thread.
+ * @param clustering A clustering state without medoids, which receives the initial clustering.
  */
-pam_data build(int const k, Eigen::MatrixXd const &distances)
+template<typename Distances>
+void build(int const k, Distances const &distances, int const threads, pam_data_for<Distances> *clustering)
 {
   // select an initial medoid by finding the observation with the minimum sum of dissimilarities
-  int const initial_medoid = find_initial_medoid(distances);
+  int const initial_medoid = find_initial_medoid(distances, threads, &clustering->sums_of_dissimilarities);
 
   // create the initial clustering based on the initial medoid
-  pam_data initial_clustering(static_cast<int>(distances.rows()), initial_medoid);
+  add_medoid(distances, initial_medoid, clustering);
 
   // refine the initial clustering with an additional k - 1 medoids
   for(int i = 0; i < k - 1; ++i) {
-    initial_clustering.add_medoid(find_next_medoid(distances, initial_clustering));
-    reclassify_objects(distances, &initial_clustering);
+    add_medoid(distances, find_next_medoid(distances, *clustering, threads, &clustering->range_candidates), clustering);
   }
+}
+
+template<typename Distances>
+pam_data_for<Distances> build(int const k, Distances const &distances, int const threads)
+{
+  pam_data_for<Distances> initial_clustering(static_cast<int>(distances.rows()), k);
+  build(k, distances, threads, &initial_clustering);
 
   return initial_clustering;
 }
 
 /**
- * Calculates the effect a swap between i and h will have on the value of the clustering.
+ * Choose the nonselected object of a sample that decreases the sum of dissimilarities within the sample the most. The
+ * first medoid minimizes the sum of dissimilarities to the sample instead.
  *
  * @param distances The distance matrix.
- * @param i A currently selected medoid.
- * @param h An object that has not been selected as a medoid.
+ * @param sample The nonselected objects to consider.
  * @param clustering The current clustering state.
  *
- * @return The total contribution of the swap. A negative value means the swap improves the clustering.
+ * @return The object that was found to be the medoid.
  */
-double calculate_swap_cost(Eigen::MatrixXd const &distances,
-    int const i,
-    int const h,
-    pam_data const &clustering)
+template<typename Distances>
+int find_next_sampled_medoid(Distances const &distances,
+    std::vector<int> const &sample,
+    pam_data_for<Distances> const &clustering)
 {
-  auto nonselected = clustering.nonselected;
-  nonselected.erase(h);
+  auto const first_medoid = clustering.medoids.empty();
+
+  double maximum_gain = std::numeric_limits<double>::lowest();
+  int next_medoid = -1;
 
-  double total_contribution = 0.0;
-  for(auto const j : nonselected) {
-    auto const D_j = distances(j, clustering.classification[j]);
-    auto const d_j_i = distances(j, i);
-    auto const d_j_h = distances(j, h);
+  for(auto const i : sample) {
+    double gain = 0.0;
 
-    double contribution = 0.0;
-    if(D_j >= d_j_i) {
-      // j is not further from i than its current (and therefore any other) medoid
+    for(auto const j : sample) {
+      if(j == i) {
+        continue;
+      }
 
-      // calculate distance to second closest medoid
-      auto const E_j = distances(j, clustering.second_closest_medoid[j]);
+      auto const d_j_i = distances(j, i);
 
-      if(d_j_h < E_j) {
-        // j is closer to h than the second closest medoid
-        // if j is closer to i than h, contribution is positive (swap is not favourable)
-        contribution = d_j_h - d_j_i;
+      if(first_medoid) {
+        gain -= d_j_i;
       } else {
-        // j is at least as distant to h than the second closest medoid
-        // contribution is always positive because h is futher away
-        contribution = E_j - D_j;
+        gain += std::max(clustering.nearest_distance[j] - d_j_i, decltype(d_j_i)(0));
       }
-    } else if(D_j < d_j_i && D_j > d_j_h) {
-      // j is more distance from i but closer to h
-      contribution = d_j_h - D_j;
     }
 
-    // add up all the contributions for the total result of a swap
-    total_contribution += contribution;
+    // prefer the lowest object on ties, regardless of the order of the sample
+    if(gain > maximum_gain || (gain == maximum_gain && i < next_medoid)) {
+      maximum_gain = gain;
+      next_medoid = i;
+    }
   }
 
-  return total_contribution;
+  return next_medoid;
 }
 
 /**
- * Attempt to improve the set of medoids by considering all pairs of objects where a medoid i has been selected but an
- * object h has not, and testing if a swap is beneficial.
+ * Choose k medoids as BUILD does, but only consider a random subsample of 10 + sqrt(n) nonselected objects for each
+ * medoid (LAB, see Schubert and Rousseeuw, 2019).
  *
+ * @param k The number of initial clusters to find.
  * @param distances The distance matrix.
- * @param clustering The clustering state to improve.
+ * @param seed The seed of the random number generator that draws the subsamples.
+ * @param clustering A clustering state without medoids, which receives the initial clustering.
  */
-void refine(Eigen::MatrixXd const &distances, pam_data *clustering)
+template<typename Distances>
+void build_lab(int const k, Distances const &distances, unsigned const seed, pam_data_for<Distances> *clustering)
 {
-  bool perform_swaps = true;
+  auto const number_of_objects = static_cast<int>(distances.rows());
+  auto const sample_size = 10 + static_cast<int>(std::ceil(std::sqrt(static_cast<double>(number_of_objects))));
 
-  while(perform_swaps) {
-    double minimum_contribution = std::numeric_limits<double>::max();
-    int old_medoid = -1;
-    int new_medoid = -1;
-
-    for(auto const i : clustering->medoids) {
-      for(auto const h : clustering->nonselected) {
-        auto const contribution = calculate_swap_cost(distances, i, h, *clustering);
-
-        // minimize the total result of a swap (i.e., most negative contribution)
-        if(contribution < minimum_contribution) {
-          minimum_contribution = contribution;
-          old_medoid = i;
-          new_medoid = h;
+  // the nonselected objects are kept at the front of a list, so that a sample can be drawn by a partial shuffle
+  std::vector<int> nonselected(number_of_objects);
+  for(int i = 0; i < number_of_objects; ++i) {
+    nonselected[i] = i;
+  }
+
+  std::vector<int> sample;
+  sample.reserve(std::min(sample_size, number_of_objects));
+
+  std::mt19937 generator(seed);
+
+  for(int remaining = number_of_objects; remaining > number_of_objects - k; --remaining) {
+    auto const size = std::min(sample_size, remaining);
+
+    for(int i = 0; i < size; ++i) {
+      std::uniform_int_distribution<int> random_position(i, remaining - 1);
+      std::swap(nonselected[i], nonselected[random_position(generator)]);
+    }
+
+    sample.assign(nonselected.begin(), nonselected.begin() + size);
+    auto const medoid = find_next_sampled_medoid(distances, sample, *clustering);
+
+    // move the medoid behind the nonselected objects
+    auto const position = std::find(nonselected.begin(), nonselected.begin() + size, medoid);
+    std::swap(*position, nonselected[remaining - 1]);
+
+    add_medoid(distances, medoid, clustering);
+  }
+}
+
+/**
+ * Choose k medoids at random, where the first medoid is chosen uniformly and each further object is chosen with a
+ * probability proportional to its squared distance to the nearest medoid (k-medoids++).
+ *
+ * @param k The number of initial clusters to find.
+ * @param distances The distance matrix.
+ * @param seed The seed of the random number generator.
+ * @param clustering A clustering state without medoids, which receives the initial clustering.
+ */
+template<typename Distances>
+void build_plus_plus(int const k, Distances const &distances, unsigned const seed, pam_data_for<Distances> *clustering)
+{
+  auto const number_of_objects = static_cast<int>(distances.rows());
+
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> random_object(0, number_of_objects - 1);
+
+  add_medoid(distances, random_object(generator), clustering);
+
+  while(static_cast<int>(clustering->medoids.size()) < k) {
+    double sum_of_squares = 0.0;
+    for(auto const distance : clustering->nearest_distance) {
+      sum_of_squares += static_cast<double>(distance) * distance;
+    }
+
+    int medoid = -1;
+
+    if(sum_of_squares > 0.0) {
+      // find the object where the cumulative sum of squared distances passes a uniform threshold
+      auto const threshold = std::uniform_real_distribution<double>(0.0, sum_of_squares)(generator);
+
+      double cumulative_sum = 0.0;
+      for(int i = 0; i < number_of_objects; ++i) {
+        auto const distance = static_cast<double>(clustering->nearest_distance[i]);
+        cumulative_sum += distance * distance;
+
+        if(cumulative_sum > threshold && !clustering->is_medoid(i)) {
+          medoid = i;
+          break;
         }
       }
     }
 
-    if(minimum_contribution < 0 && old_medoid >= 0 && new_medoid >= 0) {
-      // if the minimum contribution was negative, perform the swap and iterate again
-      clustering->swap_medoid(old_medoid, new_medoid);
-      reclassify_objects(distances, clustering);
-    } else {
-      // a positive minimum contribution means that no swaps were favourable
-      perform_swaps = false;
+    // every object coincides with a medoid, or rounding left the threshold unreached, so choose uniformly instead
+    while(medoid < 0 || clustering->is_medoid(medoid)) {
+      medoid = random_object(generator);
     }
+
+    add_medoid(distances, medoid, clustering);
   }
 }
 
-pam_result partition_around_medoids(int k, Eigen::MatrixXd const &matrix)
+template<typename Distances>
+void initialize(int const k, Distances const &distances, pam_options const &options, pam_data_for<Distances> *clustering)
 {
-  if(k < 2) {
-    throw std::runtime_error("Error: less than two partitions were requested.");
-  } else if(matrix.rows() < k) {
-    throw std::runtime_error("Error: not enough rows to create k partitions.");
+  clustering->reset(static_cast<int>(distances.rows()), k);
+
+  // start from the given medoids, which only needs each object to be assigned to them
+  if(!options.initial_medoids.empty()) {
+    for(auto const medoid : options.initial_medoids) {
+      add_medoid(distances, medoid, clustering);
+    }
+
+    return;
   }
 
-  // calculate the distances between observations
-  Eigen::MatrixXd const distances = calculate_distance_matrix(matrix);
+  switch(options.init) {
+  case init_strategy::lab:
+    build_lab(k, distances, options.seed, clustering);
+    break;
+  case init_strategy::k_medoids_plus_plus:
+    build_plus_plus(k, distances, options.seed, clustering);
+    break;
+  case init_strategy::automatic:
+  case init_strategy::build:
+  default:
+    build(k, distances, options.threads, clustering);
+    break;
+  }
+}
 
-  // build an initial clustering based on the minimum dissimilarity between objects
-  auto initial_clustering = build(k, distances);
+template<typename Distances>
+pam_data_for<Distances> initialize(int const k, Distances const &distances, pam_options const &options)
+{
+  pam_data_for<Distances> initial_clustering(static_cast<int>(distances.rows()), k);
+  initialize(k, distances, options, &initial_clustering);
 
-  // refine the initial clustering by swapping medoids and optimizing the objective function
-  refine(distances, &initial_clustering);
+  return initial_clustering;
+}
 
-  // copy the intermediate data into the final result
-  pam_result final_clustering;
-  final_clustering.medoids = initial_clustering.medoids;
+/**
+ * Calculates the effect a swap between every medoid and h will have on the value of the clustering. All k candidate
+ * swaps are evaluated in a single pass over the objects (FastPAM1, see Schubert and Rousseeuw, 2019).
+ *
+ * A negative contribution means the swap improves the clustering. The clustering is only read, so the swaps of
+ * different objects can be evaluated at the same time.
+ *
+ * @param distances The distance matrix.
+ * @param h An object that has not been selected as a medoid.
+ * @param clustering The current clustering state.
+ * @param contributions The total contribution of swapping each medoid with h, by position of the medoid.
+ */
+template<typename Distances>
+void calculate_swap_costs(Distances const &distances,
+    int const h,
+    pam_data_for<Distances> const &clustering,
+    double *contributions)
+{
+  auto const k = clustering.medoids.size();
+  std::fill_n(contributions, k, 0.0);
+
+  // every object is considered, including the medoids and h: the removed medoid must be assigned to another medoid and
+  // h no longer contributes its distance to its nearest medoid
+  for_each_distance(distances, h, [&](int const j, typename Distances::Scalar const d_j_h) {
+    auto const D_j = clustering.nearest_distance[j];
+
+    if(d_j_h < D_j) {
+      // j is closer to h than to its nearest (and so its second nearest) medoid, so removing any medoid moves j to h;
+      // the change is added to every swap as j is reached, so each swap adds up the same values in the same order as
+      // the classic SWAP and finds exactly the same sum
+      for(std::size_t m = 0; m < k; ++m) {
+        contributions[m] += d_j_h - D_j;
+      }
+    } else {
+      // only removing the nearest medoid moves j, to h or to its second nearest medoid, whichever is closer
+      contributions[clustering.nearest[j]] += std::min(d_j_h, clustering.second_distance[j]) - D_j;
+    }
+  });
+}
+
+/**
+ * Calculates the effect a swap between every medoid and h will have on the value of the clustering, storing the
+ * contributions in the clustering state.
+ */
+template<typename Distances>
+void calculate_swap_costs(Distances const &distances, int const h, pam_data_for<Distances> *clustering)
+{
+  clustering->contributions.resize(clustering->medoids.size());
+  calculate_swap_costs(distances, h, *clustering, clustering->contributions.data());
+}
+
+template<typename Distances>
+void swap_medoid(Distances const &distances, int const old_medoid, int const new_medoid, pam_data_for<Distances> *clustering)
+{
+  clustering->swap_medoid(old_medoid, new_medoid);
+
+  // the new medoid takes the position of the old medoid
+  auto const index = clustering->medoid_index[new_medoid];
+  auto const number_of_medoids = static_cast<int>(clustering->medoids.size());
+
+  auto &reassigned = clustering->reassigned;
+  reassigned.clear();
 
-  int cluster_id = 0;
-  for(auto const &medoid : final_clustering.medoids) {
-    final_clustering.medoid_to_cluster[medoid] = cluster_id;
-    ++cluster_id;
+  for_each_distance(distances, new_medoid, [&](int const object, typename Distances::Scalar const distance) {
+    if(object == old_medoid || object == new_medoid || clustering->nearest[object] == index
+        || clustering->second[object] == index) {
+      // the old medoid was the nearest or second nearest, so every medoid must be examined
+      unassign_object(object, clustering);
+      reassigned.push_back(object);
+    } else if(is_closer(distance,
+                  new_medoid,
+                  clustering->nearest_distance[object],
+                  clustering->medoids[clustering->nearest[object]])) {
+      // the remaining medoids keep their order, so only the new medoid must be examined
+      clustering->second[object] = clustering->nearest[object];
+      clustering->second_distance[object] = clustering->nearest_distance[object];
+
+      clustering->nearest[object] = index;
+      clustering->nearest_distance[object] = distance;
+    } else if(is_closer(distance,
+                  new_medoid,
+                  clustering->second_distance[object],
+                  clustering->medoid_at(clustering->second[object]))) {
+      clustering->second[object] = index;
+      clustering->second_distance[object] = distance;
+    }
+  });
+
+  // the reassigned objects consider one medoid at a time, so the distances to each medoid are read together
+  for(int m = 0; m < number_of_medoids; ++m) {
+    auto const medoid = clustering->medoids[m];
+
+    for(auto const object : reassigned) {
+      consider_medoid(object, m, distances(object, medoid), clustering);
+    }
   }
 
-  for(auto const &object : initial_clustering.classification) {
-    final_clustering.classification.push_back(final_clustering.medoid_to_cluster[object]);
+  clustering->total_dissimilarity = sum_nearest_distances(*clustering);
+}
+
+/**
+ * Determine if a swap improves the clustering by more than the rounding error in its contribution, as in the pam
+ * implementation of the R cluster package. A swap between equally good medoids may otherwise appear favourable in both
+ * directions and be performed forever.
+ *
+ * @param contribution The contribution of the swap.
+ * @param clustering The current clustering state.
+ */
+template<typename Scalar>
+bool is_favourable(double contribution, pam_data<Scalar> const &clustering)
+{
+  return contribution < -16 * std::numeric_limits<double>::epsilon() * clustering.total_dissimilarity;
+}
+
+/**
+ * Find the best swap for each medoid with the nonselected objects in a range, preferring the lowest h on ties.
+ *
+ * @param distances The distance matrix.
+ * @param first The first object of the range.
+ * @param last The object after the last object of the range.
+ * @param clustering The current clustering state.
+ * @param contributions Storage for the contribution of swapping each medoid with one object.
+ * @param best_swaps The best swap for each medoid (by position), or a swap with h = -1 if the range has no candidates.
+ */
+template<typename Distances>
+void find_best_swaps(Distances const &distances,
+    int const first,
+    int const last,
+    pam_data_for<Distances> const &clustering,
+    double *contributions,
+    swap_candidate *best_swaps)
+{
+  auto const k = clustering.medoids.size();
+
+  for(std::size_t m = 0; m < k; ++m) {
+    best_swaps[m] = {std::numeric_limits<double>::max(), clustering.medoids[m], -1};
   }
 
-  return final_clustering;
+  for(int h = first; h < last; ++h) {
+    if(clustering.is_medoid(h)) {
+      continue;
+    }
+
+    calculate_swap_costs(distances, h, clustering, contributions);
+
+    for(std::size_t m = 0; m < k; ++m) {
+      // minimize the total result of a swap (i.e., most negative contribution), preferring the lowest h on ties
+      if(contributions[m] < best_swaps[m].contribution) {
+        best_swaps[m].contribution = contributions[m];
+        best_swaps[m].h = h;
+      }
+    }
+  }
 }
+
+/**
+ * Attempt to improve the set of medoids by considering all pairs of objects where a medoid i has been selected but an
+ * object h has not, and performing the best swaps found after each pass.
+ *
+ * The objects h are divided into contiguous ranges that are evaluated in parallel, each with its own best swaps. The
+ * ranges are then combined in order of h, so the same swaps are found regardless of the number of threads.
+ *
+ * @param distances The distance matrix.
+ * @param swaps_per_pass The maximum number of swaps, each removing a different medoid, to perform after each pass.
+ * @param threads The number of threads used to evaluate swaps, where zero uses one thread per hardware thread.
+ * @param clustering The clustering state to improve.
+ *
+ * @return The number of passes and swaps performed.
+ */
+template<typename Distances>
+swap_statistics refine_best(Distances const &distances,
+    int const swaps_per_pass,
+    int const threads,
+    pam_data_for<Distances> *clustering)
+{
+  swap_statistics statistics;
+
+  auto &best_swaps = clustering->best_swaps;
+  auto const &contributions = clustering->contributions;
+
+  auto const number_of_objects = static_cast<int>(distances.rows());
+  auto const k = clustering->medoids.size();
+
+  auto const workers = detail::thread_count(concurrent_readers(distances, threads));
+  auto const ranges = number_of_ranges(number_of_objects, workers);
+
+  best_swaps.resize(k);
+  clustering->contributions.resize(k);
+
+  if(ranges > 1) {
+    clustering->range_contributions.resize(ranges * k);
+    clustering->range_best_swaps.resize(ranges * k);
+  }
+
+  bool perform_swaps = true;
+
+  while(perform_swaps) {
+    ++statistics.passes;
+
+    if(ranges == 1) {
+      find_best_swaps(distances, 0, number_of_objects, *clustering, clustering->contributions.data(), best_swaps.data());
+    } else {
+      detail::parallel_for(ranges, workers, [&](int range) {
+        find_best_swaps(distances,
+            range_begin(number_of_objects, range, ranges),
+            range_begin(number_of_objects, range + 1, ranges),
+            *clustering,
+            clustering->range_contributions.data() + range * k,
+            clustering->range_best_swaps.data() + range * k);
+      });
+
+      // combine the ranges in order of h, so a later range only wins with a strictly better swap
+      std::copy_n(clustering->range_best_swaps.begin(), k, best_swaps.begin());
+      for(int range = 1; range < ranges; ++range) {
+        for(std::size_t m = 0; m < k; ++m) {
+          auto const &candidate = clustering->range_best_swaps[range * k + m];
+
+          if(candidate.contribution < best_swaps[m].contribution) {
+            best_swaps[m] = candidate;
+          }
+        }
+      }
+    }
+
+    // order the swaps from most to least favourable, preferring the lowest i on ties
+    std::sort(best_swaps.begin(), best_swaps.end(), [](swap_candidate const &a, swap_candidate const &b) {
+      return a.contribution < b.contribution || (a.contribution == b.contribution && a.i < b.i);
+    });
+
+    int swaps = 0;
+    for(auto const &swap : best_swaps) {
+      if(swaps == swaps_per_pass || !is_favourable(swap.contribution, *clustering)) {
+        break;
+      }
+
+      if(swaps > 0) {
+        // a previous swap may have selected h or changed the value of this swap, so evaluate it again
+        if(clustering->is_medoid(swap.h)) {
+          continue;
+        }
+
+        calculate_swap_costs(distances, swap.h, clustering);
+
+        if(!is_favourable(contributions[clustering->medoid_index[swap.i]], *clustering)) {
+          continue;
+        }
+      }
+
+      swap_medoid(distances, swap.i, swap.h, clustering);
+      ++swaps;
+    }
+
+    // no swaps were performed if none of them were favourable
+    statistics.swaps += swaps;
+    perform_swaps = swaps > 0;
+  }
+
+  return statistics;
+}
+
+/**
+ * Find the most favourable of the swaps evaluated by calculate_swap_costs, preferring the lowest medoid on ties.
+ *
+ * @param clustering The current clustering state.
+ *
+ * @return The position of the medoid to swap.
+ */
+template<typename Scalar>
+int find_best_swap(pam_data<Scalar> const &clustering)
+{
+  auto const &contributions = clustering.contributions;
+
+  int best = 0;
+  for(std::size_t m = 1; m < contributions.size(); ++m) {
+    if(contributions[m] < contributions[best]
+        || (contributions[m] == contributions[best] && clustering.medoids[m] < clustering.medoids[best])) {
+      best = static_cast<int>(m);
+    }
+  }
+
+  return best;
+}
+
+/**
+ * Attempt to improve the set of medoids by visiting each nonselected object h in turn and immediately performing the
+ * best swap involving h if it is favourable (FasterPAM, see Schubert and Rousseeuw, 2021). Refinement ends once every
+ * object has been visited without finding a favourable swap.
+ *
+ * @param distances The distance matrix.
+ * @param clustering The clustering state to improve.
+ *
+ * @return The number of passes and swaps performed.
+ */
+template<typename Distances>
+swap_statistics refine_eager(Distances const &distances, pam_data_for<Distances> *clustering)
+{
+  swap_statistics statistics;
+
+  auto const &contributions = clustering->contributions;
+  auto const number_of_objects = static_cast<int>(distances.rows());
+
+  int last_swap = 0;
+  int h = 0;
+
+  do {
+    if(h == 0) {
+      ++statistics.passes;
+    }
+
+    if(!clustering->is_medoid(h)) {
+      calculate_swap_costs(distances, h, clustering);
+
+      auto const best = find_best_swap(*clustering);
+
+      if(is_favourable(contributions[best], *clustering)) {
+        swap_medoid(distances, clustering->medoids[best], h, clustering);
+
+        ++statistics.swaps;
+        last_swap = h;
+      }
+    }
+
+    h = (h + 1) % number_of_objects;
+  } while(h != last_swap);
+
+  return statistics;
+}
+
+/**
+ * Replace the medoids of a clustering with k objects chosen at random.
+ *
+ * @param distances The distance matrix.
+ * @param k The number of medoids to choose.
+ * @param generator The random number generator.
+ * @param clustering The clustering state to modify.
+ */
+template<typename Distances, typename Generator>
+void select_random_medoids(Distances const &distances, int const k, Generator *generator, pam_data_for<Distances> *clustering)
+{
+  std::uniform_int_distribution<int> random_object(0, static_cast<int>(distances.rows()) - 1);
+
+  clustering->clear();
+  while(static_cast<int>(clustering->medoids.size()) < k) {
+    auto const medoid = random_object(*generator);
+
+    if(!clustering->is_medoid(medoid)) {
+      add_medoid(distances, medoid, clustering);
+    }
+  }
+}
+
+/**
+ * Attempt to improve the set of medoids by evaluating the swaps of randomly chosen nonselected objects h, performing
+ * the best swap involving h if it is favourable. A search ends once a number of objects in a row had no favourable
+ * swap, after which the search restarts from random medoids. The best clustering found by any search is kept (CLARANS,
+ * with all swaps of h evaluated at once as in FastCLARANS, see Schubert and Rousseeuw, 2021).
+ *
+ * @param distances The distance matrix.
+ * @param options The number of neighbours, restarts and the seed to use.
+ * @param clustering The clustering state to improve, which is the start of the first search.
+ *
+ * @return The number of searches and swaps performed.
+ */
+template<typename Distances>
+swap_statistics refine_randomized(Distances const &distances, pam_options const &options, pam_data_for<Distances> *clustering)
+{
+  swap_statistics statistics;
+
+  auto const number_of_objects = static_cast<int>(distances.rows());
+  auto const k = static_cast<int>(clustering->medoids.size());
+
+  if(number_of_objects == k) {
+    // there are no objects to swap with
+    return statistics;
+  }
+
+  auto const max_neighbours =
+      options.max_neighbours > 0 ? options.max_neighbours : std::max(250, (number_of_objects - k) / 40);
+
+  std::mt19937 generator(options.seed);
+  std::uniform_int_distribution<int> random_object(0, number_of_objects - 1);
+
+  pam_data_for<Distances> best_clustering(0, 0);
+
+  for(int search = 0; search <= options.restarts; ++search) {
+    ++statistics.passes;
+
+    if(search > 0) {
+      select_random_medoids(distances, k, &generator, clustering);
+    }
+
+    int failures = 0;
+    while(failures < max_neighbours) {
+      int h;
+      do {
+        h = random_object(generator);
+      } while(clustering->is_medoid(h));
+
+      calculate_swap_costs(distances, h, clustering);
+      auto const best = find_best_swap(*clustering);
+
+      if(is_favourable(clustering->contributions[best], *clustering)) {
+        swap_medoid(distances, clustering->medoids[best], h, clustering);
+
+        ++statistics.swaps;
+        failures = 0;
+      } else {
+        ++failures;
+      }
+    }
+
+    if(options.restarts > 0 && (search == 0 || clustering->total_dissimilarity < best_clustering.total_dissimilarity)) {
+      best_clustering = *clustering;
+    }
+  }
+
+  if(options.restarts > 0) {
+    *clustering = std::move(best_clustering);
+  }
+
+  return statistics;
+}
+
+/**
+ * Find the member of a cluster with the minimum sum of dissimilarities to the other members. The current medoid is
+ * kept unless another member is strictly better, so that the total dissimilarity never increases.
+ *
+ * @param distances The distance matrix.
+ * @param members The objects assigned to the cluster, including its medoid.
+ * @param medoid The current medoid of the cluster.
+ *
+ * @return The medoid of the cluster.
+ */
+template<typename Distances>
+int find_cluster_medoid(Distances const &distances, std::vector<int> const &members, int const medoid)
+{
+  double minimum_sum = 0.0;
+  for(auto const j : members) {
+    minimum_sum += distances(j, medoid);
+  }
+
+  int cluster_medoid = medoid;
+
+  for(auto const i : members) {
+    if(i == medoid) {
+      continue;
+    }
+
+    double sum_of_dissimilarities = 0.0;
+    for(auto const j : members) {
+      sum_of_dissimilarities += distances(j, i);
+
+      // the distances are not negative, so i cannot improve on the best member once its sum is larger
+      if(sum_of_dissimilarities >= minimum_sum) {
+        break;
+      }
+    }
+
+    if(sum_of_dissimilarities < minimum_sum) {
+      minimum_sum = sum_of_dissimilarities;
+      cluster_medoid = i;
+    }
+  }
+
+  return cluster_medoid;
+}
+
+/**
+ * Improve the set of medoids by alternating between assigning each object to its nearest medoid and replacing the
+ * medoid of each cluster with the member that minimizes the sum of dissimilarities within the cluster (Park and Jun,
+ * 2009). Each update only reads the distances within a cluster, and the clusters are updated in parallel.
+ *
+ * @param distances The distance matrix.
+ * @param options The maximum number of iterations and the number of threads to use.
+ * @param clustering The clustering state to improve.
+ *
+ * @return The number of iterations and the number of medoids that were replaced.
+ */
+template<typename Distances>
+swap_statistics alternate(Distances const &distances, pam_options const &options, pam_data_for<Distances> *clustering)
+{
+  swap_statistics statistics;
+
+  auto const k = static_cast<int>(clustering->medoids.size());
+  auto const threads = concurrent_readers(distances, options.threads);
+
+  std::vector<std::vector<int>> members(k);
+  std::vector<int> medoids(k);
+
+  while(statistics.passes < options.max_iterations) {
+    ++statistics.passes;
+
+    for(auto &cluster : members) {
+      cluster.clear();
+    }
+
+    for(int object = 0; object < distances.rows(); ++object) {
+      members[clustering->nearest[object]].push_back(object);
+    }
+
+    detail::parallel_for(k, threads, [&](int m) {
+      medoids[m] = find_cluster_medoid(distances, members[m], clustering->medoids[m]);
+    });
+
+    int replaced = 0;
+    for(int m = 0; m < k; ++m) {
+      if(medoids[m] != clustering->medoids[m]) {
+        clustering->swap_medoid(clustering->medoids[m], medoids[m]);
+        ++replaced;
+      }
+    }
+
+    if(replaced == 0) {
+      break;
+    }
+
+    // assign every object to its nearest medoid again
+    reclassify_objects(distances, clustering);
+    statistics.swaps += replaced;
+  }
+
+  return statistics;
+}
+
+namespace {
+
+/**
+ * @return The options used by alternating_medoids, which chooses the initial medoids with LAB unless a strategy is
+ * selected.
+ */
+pam_options alternating_options(pam_options options)
+{
+  if(options.init == init_strategy::automatic) {
+    options.init = init_strategy::lab;
+  }
+
+  return options;
+}
+}
+
+template<typename Distances>
+swap_statistics refine(Distances const &distances, pam_options const &options, pam_data_for<Distances> *clustering)
+{
+  switch(options.swap) {
+  case swap_strategy::eager:
+    return refine_eager(distances, clustering);
+  case swap_strategy::randomized:
+    return refine_randomized(distances, options, clustering);
+  case swap_strategy::best:
+  default:
+    return refine_best(distances, options.swaps_per_pass, options.threads, clustering);
+  }
+}
+
+namespace detail {
+
+void validate(int const k, int const number_of_objects, pam_options const &options)
+{
+  if(k < 2) {
+    throw std::runtime_error("Error: less than two partitions were requested.");
+  } else if(number_of_objects < k) {
+    throw std::runtime_error("Error: not enough rows to create k partitions.");
+  } else if(options.swaps_per_pass < 1) {
+    throw std::runtime_error("Error: at least one swap per pass must be allowed.");
+  } else if(options.max_neighbours < 0) {
+    throw std::runtime_error("Error: the number of neighbours cannot be negative.");
+  } else if(options.restarts < 0) {
+    throw std::runtime_error("Error: the number of restarts cannot be negative.");
+  } else if(options.max_iterations < 1) {
+    throw std::runtime_error("Error: at least one iteration must be allowed.");
+  }
+
+  if(options.initial_medoids.empty()) {
+    return;
+  } else if(static_cast<int>(options.initial_medoids.size()) != k) {
+    throw std::runtime_error("Error: the number of initial medoids must be k.");
+  }
+
+  auto medoids = options.initial_medoids;
+  std::sort(medoids.begin(), medoids.end());
+
+  if(medoids.front() < 0 || medoids.back() >= number_of_objects) {
+    throw std::runtime_error("Error: an initial medoid is not one of the objects.");
+  } else if(std::adjacent_find(medoids.begin(), medoids.end()) != medoids.end()) {
+    throw std::runtime_error("Error: the initial medoids must be distinct.");
+  }
+}
+}
+
+pam_result to_pam_result(flat_pam_result const &result)
+{
+  pam_result expanded;
+  expanded.passes = result.passes;
+  expanded.swaps = result.swaps;
+  expanded.initialization_time = result.initialization_time;
+  expanded.swap_time = result.swap_time;
+  expanded.medoids.insert(result.medoids.begin(), result.medoids.end());
+
+  for(std::size_t c = 0; c < result.medoids.size(); ++c) {
+    expanded.medoid_to_cluster[result.medoids[c]] = static_cast<int>(c);
+  }
+
+  expanded.classification.assign(result.labels.begin(), result.labels.end());
+
+  return expanded;
+}
+
+/**
+ * A phase that improves an initial clustering, such as refine or alternate.
+ */
+template<typename Distances>
+using improvement = swap_statistics (*)(Distances const &, pam_options const &, pam_data_for<Distances> *);
+
+/**
+ * Copy a clustering into a flat result in a single pass over the objects. Cluster IDs are assigned in increasing order
+ * of the medoids.
+ *
+ * @param clustering The clustering state to report.
+ * @param result The result to fill, whose storage is reused.
+ */
+template<typename Scalar>
+void report(pam_data<Scalar> *clustering, flat_pam_result *result)
+{
+  auto const k = clustering->medoids.size();
+  auto const number_of_objects = clustering->nearest.size();
+
+  result->medoids.assign(clustering->medoids.begin(), clustering->medoids.end());
+  std::sort(result->medoids.begin(), result->medoids.end());
+
+  clustering->cluster_ids.resize(k);
+  for(std::size_t c = 0; c < k; ++c) {
+    clustering->cluster_ids[clustering->medoid_index[result->medoids[c]]] = static_cast<int>(c);
+  }
+
+  result->labels.resize(number_of_objects);
+  result->distances.resize(number_of_objects);
+  result->total_dissimilarity = clustering->total_dissimilarity;
+
+  for(std::size_t object = 0; object < number_of_objects; ++object) {
+    result->labels[object] = clustering->cluster_ids[clustering->nearest[object]];
+    result->distances[object] = clustering->nearest_distance[object];
+  }
+}
+
+/**
+ * Minimize the sum of dissimilarities to a set of k medoids.
+ *
+ * @param k The number of clusters.
+ * @param distances The distance matrix, either a dense or a condensed matrix.
+ * @param options Options that control how medoids are found.
+ * @param improve The phase that improves the initial clustering.
+ * @param clustering The clustering state, whose storage is reused.
+ * @param result The clustering found.
+ */
+template<typename Distances>
+void partition(int const k,
+    Distances const &distances,
+    pam_options const &options,
+    improvement<Distances> improve,
+    pam_data_for<Distances> *clustering,
+    flat_pam_result *result)
+{
+  auto const start = std::chrono::steady_clock::now();
+
+  // both phases read the distances to one object at a time, and before the diagonal each of them is found in a
+  // different row of condensed storage, so reading ahead of them would mostly read distances that are not needed yet
+  advise(distances, access_pattern::random);
+
+  // build an initial clustering based on the minimum dissimilarity between objects
+  initialize(k, distances, options, clustering);
+  auto const initialized = std::chrono::steady_clock::now();
+
+  // refine the initial clustering by swapping medoids and optimizing the objective function
+  auto const statistics = improve(distances, options, clustering);
+  auto const end = std::chrono::steady_clock::now();
+
+  advise(distances, access_pattern::normal);
+
+  // copy the intermediate data into the final result
+  report(clustering, result);
+  result->passes = statistics.passes;
+  result->swaps = statistics.swaps;
+  result->initialization_time = std::chrono::duration<double>(initialized - start).count();
+  result->swap_time = std::chrono::duration<double>(end - initialized).count();
+}
+
+template<typename Distances>
+void partition(int const k,
+    Distances const &distances,
+    pam_options const &options,
+    improvement<Distances> improve,
+    flat_pam_result *result)
+{
+  pam_data_for<Distances> clustering(static_cast<int>(distances.rows()), k);
+  partition(k, distances, options, improve, &clustering, result);
+}
+
+/**
+ * Minimize the sum of dissimilarities to a set of k medoids.
+ *
+ * @return The clustering found.
+ */
+template<typename Distances>
+pam_result partition(int const k, Distances const &distances, pam_options const &options, improvement<Distances> improve)
+{
+  flat_pam_result result;
+  partition(k, distances, options, improve, &result);
+
+  return to_pam_result(result);
+}
+
+/**
+ * View a square matrix of dissimilarities in column-major order without copying it.
+ */
+template<typename Scalar>
+detail::column_major_observations<Scalar> as_column_major(detail::column_major_observations<Scalar> const &matrix)
+{
+  return matrix;
+}
+
+template<typename Scalar>
+detail::column_major_observations<Scalar> as_column_major(detail::row_major_observations<Scalar> const &matrix)
+{
+  // the dissimilarities are symmetric, so their transpose is the same matrix in column-major order
+  return detail::column_major_observations<Scalar>(matrix.transpose());
+}
+
+/**
+ * View a matrix of dissimilarities in column-major order, ensuring that it is square.
+ */
+template<typename Observations>
+detail::column_major_observations<typename Observations::Scalar> as_dissimilarities(Observations const &matrix)
+{
+  if(matrix.rows() != matrix.cols()) {
+    throw std::runtime_error("Error: a matrix of dissimilarities must be square.");
+  }
+
+  return as_column_major(matrix);
+}
+
+namespace detail {
+
+template<typename Observations>
+void partition_precomputed(int k, Observations const &matrix, pam_options const &options, flat_pam_result *result)
+{
+  using Distances = column_major_observations<typename Observations::Scalar>;
+
+  // use the dissimilarities as they are, without copying them
+  partition(k, as_dissimilarities(matrix), options, &refine<Distances>, result);
+}
+
+template<typename Observations>
+void alternate_precomputed(int k, Observations const &matrix, pam_options const &options, flat_pam_result *result)
+{
+  using Distances = column_major_observations<typename Observations::Scalar>;
+
+  partition(k, as_dissimilarities(matrix), alternating_options(options), &alternate<Distances>, result);
+}
+
+#define CLUSTER_INSTANTIATE_PRECOMPUTED(Observations)                                                     \
+  template void partition_precomputed(int, Observations const &, pam_options const &, flat_pam_result *); \
+  template void alternate_precomputed(int, Observations const &, pam_options const &, flat_pam_result *);
+
+CLUSTER_INSTANTIATE_PRECOMPUTED(column_major_observations<float>)
+CLUSTER_INSTANTIATE_PRECOMPUTED(row_major_observations<float>)
+CLUSTER_INSTANTIATE_PRECOMPUTED(column_major_observations<double>)
+CLUSTER_INSTANTIATE_PRECOMPUTED(row_major_observations<double>)
+
+#undef CLUSTER_INSTANTIATE_PRECOMPUTED
+}
+
+template<typename Scalar>
+pam_result partition_around_medoids(int k, basic_condensed_matrix<Scalar> const &distances, pam_options const &options)
+{
+  detail::validate(k, distances.rows(), options);
+
+  return partition(k, distances, options, &refine<basic_condensed_matrix<Scalar>>);
+}
+
+template<typename Scalar>
+pam_result partition_around_medoids(int k, basic_distance_oracle<Scalar> const &distances, pam_options const &options)
+{
+  detail::validate(k, distances.rows(), options);
+
+  return partition(k, distances, options, &refine<basic_distance_oracle<Scalar>>);
+}
+
+template<typename Scalar>
+pam_result partition_around_medoids(int k,
+    basic_mapped_condensed_matrix<Scalar> const &distances,
+    pam_options const &options)
+{
+  detail::validate(k, distances.rows(), options);
+
+  return partition(k, distances, options, &refine<basic_mapped_condensed_matrix<Scalar>>);
+}
+
+template<typename Scalar>
+void partition_around_medoids(int k,
+    basic_condensed_matrix<Scalar> const &distances,
+    pam_options const &options,
+    flat_pam_result *result)
+{
+  detail::validate(k, distances.rows(), options);
+
+  partition(k, distances, options, &refine<basic_condensed_matrix<Scalar>>, result);
+}
+
+template<typename Scalar>
+void partition_around_medoids(int k,
+    basic_distance_oracle<Scalar> const &distances,
+    pam_options const &options,
+    flat_pam_result *result)
+{
+  detail::validate(k, distances.rows(), options);
+
+  partition(k, distances, options, &refine<basic_distance_oracle<Scalar>>, result);
+}
+
+template<typename Scalar>
+void partition_around_medoids(int k,
+    basic_mapped_condensed_matrix<Scalar> const &distances,
+    pam_options const &options,
+    flat_pam_result *result)
+{
+  detail::validate(k, distances.rows(), options);
+
+  partition(k, distances, options, &refine<basic_mapped_condensed_matrix<Scalar>>, result);
+}
+
+template<typename Scalar>
+pam_result alternating_medoids(int k, basic_condensed_matrix<Scalar> const &distances, pam_options const &options)
+{
+  detail::validate(k, distances.rows(), options);
+
+  return partition(k, distances, alternating_options(options), &alternate<basic_condensed_matrix<Scalar>>);
+}
+
+template<typename Scalar>
+pam_result alternating_medoids(int k, basic_distance_oracle<Scalar> const &distances, pam_options const &options)
+{
+  detail::validate(k, distances.rows(), options);
+
+  return partition(k, distances, alternating_options(options), &alternate<basic_distance_oracle<Scalar>>);
+}
+
+template<typename Scalar>
+pam_result alternating_medoids(int k, basic_mapped_condensed_matrix<Scalar> const &distances, pam_options const &options)
+{
+  detail::validate(k, distances.rows(), options);
+
+  return partition(k, distances, alternating_options(options), &alternate<basic_mapped_condensed_matrix<Scalar>>);
+}
+
+/**
+ * Instantiate the entry points for a type of precomputed distances.
+ */
+#define CLUSTER_INSTANTIATE_ENTRY_POINTS(Distances)                                                       \
+  template pam_result partition_around_medoids(int, Distances const &, pam_options const &);              \
+  template void partition_around_medoids(int, Distances const &, pam_options const &, flat_pam_result *); \
+  template pam_result alternating_medoids(int, Distances const &, pam_options const &);
+
+CLUSTER_INSTANTIATE_ENTRY_POINTS(basic_condensed_matrix<float>)
+CLUSTER_INSTANTIATE_ENTRY_POINTS(basic_condensed_matrix<double>)
+CLUSTER_INSTANTIATE_ENTRY_POINTS(basic_distance_oracle<float>)
+CLUSTER_INSTANTIATE_ENTRY_POINTS(basic_distance_oracle<double>)
+CLUSTER_INSTANTIATE_ENTRY_POINTS(basic_mapped_condensed_matrix<float>)
+CLUSTER_INSTANTIATE_ENTRY_POINTS(basic_mapped_condensed_matrix<double>)
+
+#undef CLUSTER_INSTANTIATE_ENTRY_POINTS
+
+template<typename T>
+struct basic_pam_workspace<T>::state {
+  pam_data<T> clustering{0, 0};
+};
+
+template<typename T>
+basic_pam_workspace<T>::basic_pam_workspace()
+    : m_state(new state())
+{
+}
+
+template<typename T>
+basic_pam_workspace<T>::~basic_pam_workspace() = default;
+
+template<typename T>
+basic_pam_workspace<T>::basic_pam_workspace(basic_pam_workspace &&) noexcept = default;
+
+template<typename T>
+basic_pam_workspace<T> &basic_pam_workspace<T>::operator=(basic_pam_workspace &&) noexcept = default;
+
+template<typename T>
+flat_pam_result const &basic_pam_workspace<T>::partition_around_medoids(int k,
+    basic_condensed_matrix<Scalar> const &distances,
+    pam_options const &options)
+{
+  detail::validate(k, distances.rows(), options);
+
+  partition(k, distances, options, &refine<basic_condensed_matrix<Scalar>>, &m_state->clustering, &m_result);
+
+  return m_result;
+}
+
+template<typename T>
+template<typename Observations>
+void basic_pam_workspace<T>::partition_precomputed(int k, Observations const &matrix, pam_options const &options)
+{
+  using Distances = detail::column_major_observations<Scalar>;
+
+  partition(k, as_dissimilarities(matrix), options, &refine<Distances>, &m_state->clustering, &m_result);
+}
+
+template class basic_pam_workspace<float>;
+template class basic_pam_workspace<double>;
+
+template void basic_pam_workspace<float>::partition_precomputed(int,
+    detail::column_major_observations<float> const &,
+    pam_options const &);
+template void basic_pam_workspace<float>::partition_precomputed(int,
+    detail::row_major_observations<float> const &,
+    pam_options const &);
+template void basic_pam_workspace<double>::partition_precomputed(int,
+    detail::column_major_observations<double> const &,
+    pam_options const &);
+template void basic_pam_workspace<double>::partition_precomputed(int,
+    detail::row_major_observations<double> const &,
+    pam_options const &);
+
+/**
+ * Instantiate the phases of the algorithm that are available to other translation units for a type of distances.
+ */
+#define CLUSTER_INSTANTIATE_PHASES(Distances)                                                            \
+  template pam_data_for<Distances> build(int, Distances const &, int);                                   \
+  template pam_data_for<Distances> initialize(int, Distances const &, pam_options const &);              \
+  template void initialize(int, Distances const &, pam_options const &, pam_data_for<Distances> *);      \
+  template swap_statistics refine(Distances const &, pam_options const &, pam_data_for<Distances> *);    \
+  template swap_statistics alternate(Distances const &, pam_options const &, pam_data_for<Distances> *); \
+  template void reclassify_objects(Distances const &, pam_data_for<Distances> *);                        \
+  template void swap_medoid(Distances const &, int, int, pam_data_for<Distances> *);
+
+CLUSTER_INSTANTIATE_PHASES(detail::column_major_observations<float>)
+CLUSTER_INSTANTIATE_PHASES(detail::column_major_observations<double>)
+CLUSTER_INSTANTIATE_PHASES(basic_condensed_matrix<float>)
+CLUSTER_INSTANTIATE_PHASES(basic_condensed_matrix<double>)
+CLUSTER_INSTANTIATE_PHASES(basic_distance_oracle<float>)
+CLUSTER_INSTANTIATE_PHASES(basic_distance_oracle<double>)
+CLUSTER_INSTANTIATE_PHASES(basic_mapped_condensed_matrix<float>)
+CLUSTER_INSTANTIATE_PHASES(basic_mapped_condensed_matrix<double>)
+
+#undef CLUSTER_INSTANTIATE_PHASES
 }
@@ -0,0 +1,272 @@
+#ifndef CAPPA_CLUSTER_PAM_DATA_HPP
+#define CAPPA_CLUSTER_PAM_DATA_HPP
+
+#include "cluster/pam.hpp"
+#include "cluster/condensed_matrix.hpp"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace cluster {
+
+/**
+ * A swap of a medoid i with a nonselected object h.
+ */
+struct swap_candidate {
+  double contribution;
+  int i;
+  int h;
+};
+
+/**
+ * A nonselected object and the decrease of the objective function if it was selected as a medoid.
+ */
+struct build_candidate {
+  double gain;
+  int object;
+};
+
+/**
+ * The number of passes and swaps performed while refining a clustering.
+ */
+struct swap_statistics {
+  int passes = 0;
+  int swaps = 0;
+};
+
+/**
+ * Data used during the PAM algorithm.
+ *
+ * The assignment of objects to medoids is kept as a structure of arrays so that the build and swap phases read it
+ * sequentially. All storage is allocated when the data is created so that neither phase allocates memory, and is kept
+ * when the data is reset for another clustering of at most the same size.
+ *
+ * @tparam Scalar The type of the distances, such as float or double. Sums of distances are accumulated in double.
+ */
+template<typename Scalar>
+struct pam_data {
+  /**
+   * The selected medoids. A swap replaces a medoid in place, so the position of a medoid never changes.
+   */
+  std::vector<int> medoids;
+
+  /**
+   * The position of each object in the list of medoids, or -1 if the object has not been selected.
+   */
+  std::vector<int> medoid_index;
+
+  /**
+   * The position of the nearest and second nearest medoid of each object, or -1 if there is no such medoid.
+   */
+  std::vector<int> nearest;
+  std::vector<int> second;
+
+  /**
+   * The distance from each object to its nearest and second nearest medoid.
+   */
+  std::vector<Scalar> nearest_distance;
+  std::vector<Scalar> second_distance;
+
+  double total_dissimilarity;
+
+  /**
+   * The objects whose nearest or second nearest medoid was removed by a swap, which are compared against every medoid.
+   */
+  std::vector<int> reassigned;
+
+  /**
+   * The contribution of swapping each medoid with the candidate being evaluated.
+   */
+  std::vector<double> contributions;
+
+  /**
+   * The best swap found for each medoid during a pass.
+   */
+  std::vector<swap_candidate> best_swaps;
+
+  /**
+   * The contributions and best swaps of each range of objects evaluated in parallel, k entries per range. They are
+   * only allocated when swaps are evaluated by more than one thread.
+   */
+  std::vector<double> range_contributions;
+  std::vector<swap_candidate> range_best_swaps;
+
+  /**
+   * The sum of dissimilarities of each object and the best candidate of each range of objects, used by BUILD.
+   */
+  std::vector<double> sums_of_dissimilarities;
+  std::vector<build_candidate> range_candidates;
+
+  /**
+   * The cluster ID of the medoid at each position, which is assigned in increasing order of the medoids when the
+   * clustering is reported.
+   */
+  std::vector<int> cluster_ids;
+
+  pam_data(int number_of_objects, int number_of_medoids)
+  {
+    reset(number_of_objects, number_of_medoids);
+  }
+
+  /**
+   * Prepare the data for a clustering of a number of objects with no medoids, reusing the storage that was allocated
+   * for previous clusterings.
+   */
+  void reset(int number_of_objects, int number_of_medoids)
+  {
+    medoids.clear();
+    medoids.reserve(number_of_medoids);
+
+    medoid_index.assign(number_of_objects, -1);
+    nearest.assign(number_of_objects, -1);
+    second.assign(number_of_objects, -1);
+    nearest_distance.assign(number_of_objects, std::numeric_limits<Scalar>::max());
+    second_distance.assign(number_of_objects, std::numeric_limits<Scalar>::max());
+    total_dissimilarity = 0.0;
+
+    reassigned.reserve(number_of_objects);
+    contributions.reserve(number_of_medoids);
+    best_swaps.reserve(number_of_medoids);
+    cluster_ids.reserve(number_of_medoids);
+  }
+
+  /**
+   * Remove every medoid, without releasing any storage.
+   */
+  void clear()
+  {
+    for(auto const medoid : medoids) {
+      medoid_index[medoid] = -1;
+    }
+
+    medoids.clear();
+    std::fill(nearest.begin(), nearest.end(), -1);
+    std::fill(second.begin(), second.end(), -1);
+    std::fill(nearest_distance.begin(), nearest_distance.end(), std::numeric_limits<Scalar>::max());
+    std::fill(second_distance.begin(), second_distance.end(), std::numeric_limits<Scalar>::max());
+    total_dissimilarity = 0.0;
+  }
+
+  bool is_medoid(int object) const
+  {
+    return medoid_index[object] >= 0;
+  }
+
+  /**
+   * @return The medoid at a position in the list of medoids, or -1 for an invalid position.
+   */
+  int medoid_at(int index) const
+  {
+    return index < 0 ? -1 : medoids[index];
+  }
+
+  void add_medoid(int medoid)
+  {
+    medoid_index[medoid] = static_cast<int>(medoids.size());
+    medoids.push_back(medoid);
+  }
+
+  void swap_medoid(int old_medoid, int new_medoid)
+  {
+    auto const index = medoid_index[old_medoid];
+
+    medoid_index[old_medoid] = -1;
+    medoid_index[new_medoid] = index;
+    medoids[index] = new_medoid;
+  }
+};
+
+/**
+ * The clustering state for a type of distance matrix, which has the same scalar type as the distances.
+ */
+template<typename Distances>
+using pam_data_for = pam_data<typename Distances::Scalar>;
+
+/**
+ * Reassign every object in the current clustering by examining all medoids. The medoids are examined one at a time, so
+ * that the distances to each medoid are read together.
+ *
+ * @param distances The distance matrix, either a dense or a condensed matrix of float or double distances.
+ * @param clustering The clustering state to modify.
+ */
+template<typename Distances>
+void reclassify_objects(Distances const &distances, pam_data_for<Distances> *clustering);
+
+/**
+ * Replace a medoid and reassign objects to the new set of medoids. Only objects whose nearest or second nearest medoid
+ * was removed are compared against every medoid, one medoid at a time; all other objects are only compared against the
+ * new medoid.
+ *
+ * @param distances The distance matrix, either a dense or a condensed matrix of float or double distances.
+ * @param old_medoid The medoid to remove.
+ * @param new_medoid The nonselected object to add as a medoid.
+ * @param clustering The clustering state to modify.
+ */
+template<typename Distances>
+void swap_medoid(Distances const &distances, int old_medoid, int new_medoid, pam_data_for<Distances> *clustering);
+
+/**
+ * The first phase of pam produces an initial clustering for k objects.
+ *
+ * @param k The number of initial clusters to find.
+ * @param distances The distance matrix, either a dense or a condensed matrix of float or double distances.
+ * @param threads The number of threads used to evaluate candidates, where zero uses one thread per hardware thread.
+ *
+ * @return An initial clustering of observations to k objects.
+ */
+template<typename Distances>
+pam_data_for<Distances> build(int k, Distances const &distances, int threads = 1);
+
+/**
+ * Choose the initial medoids with the strategy selected by the options.
+ *
+ * @param k The number of initial clusters to find.
+ * @param distances The distance matrix, either a dense or a condensed matrix of float or double distances.
+ * @param options The initialization strategy and seed to use.
+ *
+ * @return An initial clustering of observations to k objects.
+ */
+template<typename Distances>
+pam_data_for<Distances> initialize(int k, Distances const &distances, pam_options const &options);
+
+/**
+ * Choose the initial medoids with the strategy selected by the options, reusing the storage of a clustering state.
+ *
+ * @param k The number of initial clusters to find.
+ * @param distances The distance matrix, either a dense or a condensed matrix of float or double distances.
+ * @param options The initialization strategy and seed to use.
+ * @param clustering The clustering state to replace with the initial clustering.
+ */
+template<typename Distances>
+void initialize(int k, Distances const &distances, pam_options const &options, pam_data_for<Distances> *clustering);
+
+/**
+ * Attempt to improve the set of medoids by swapping selected medoids with nonselected objects.
+ *
+ * @param distances The distance matrix, either a dense or a condensed matrix of float or double distances.
+ * @param options The swap strategy and the number of threads to use.
+ * @param clustering The clustering state to improve.
+ *
+ * @return The number of passes and swaps performed.
+ */
+template<typename Distances>
+swap_statistics refine(Distances const &distances, pam_options const &options, pam_data_for<Distances> *clustering);
+
+/**
+ * Improve the set of medoids by alternating between assigning objects to their nearest medoid and choosing the medoid
+ * of each cluster from its members.
+ *
+ * @param distances The distance matrix, either a dense or a condensed matrix of float or double distances.
+ * @param options The maximum number of iterations and the number of threads to use.
+ * @param clustering The clustering state to improve.
+ *
+ * @return The number of iterations and the number of medoids replaced.
+ */
+template<typename Distances>
+swap_statistics alternate(Distances const &distances, pam_options const &options, pam_data_for<Distances> *clustering);
+}
+
+#endif //CAPPA_CLUSTER_PAM_DATA_HPP